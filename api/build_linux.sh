@@ -1,5 +1,5 @@
-gcc -c neo.c -Iinclude
-gcc -c types/*.c -Iinclude
+gcc -O2 -c neo.c -Iinclude
+gcc -O2 -c types/*.c -Iinclude
 
 mkdir -p build
 ar rcs build/libneo-linux.a ./*.o
@@ -1,5 +1,5 @@
-clang -c neo.c -Iinclude
-clang -c types/*.c -Iinclude
+clang -O2 -c neo.c -Iinclude
+clang -O2 -c types/*.c -Iinclude
 
 mkdir -p build
 libtool -static -o build/libneo-mac.a neo.o types/*.o
@@ -2,8 +2,8 @@
 
 pushd %~dp0
 
-gcc -c neo.c -Iinclude -lgmp -lmpfr -lm
-gcc -c types/*.c -Iinclude -lgmp -lmpfr -lm
+gcc -O2 -c neo.c -Iinclude -lgmp -lmpfr -lm
+gcc -O2 -c types/*.c -Iinclude -lgmp -lmpfr -lm
 
 mkdir build >nul 2>&1
 ar rcs build/libneo-windows.a ./*.o
@@ -151,9 +151,33 @@ void NEO_free_hashmap(NeoHashMap *map);
 
 void NEO_free(NeoObject *obj);
 
-void NEO_reference(NeoObject *obj);
-
-void NEO_dereference(NeoObject *obj);
+// frees obj whatever its ref_count, see NEO_dereference
+void NEO_free_unsafe(NeoObject *obj);
+
+// the ref_count of an object referencing and dereferencing leave alone, like the literals of a program
+#define NEO_IMMORTAL (-1)
+
+// inline as the generated code does them around nearly every value it handles
+static inline void NEO_reference(NeoObject *obj) {
+    if (obj == NULL || obj->ref_count == NEO_IMMORTAL || obj->prototype == NeoBoolean) {
+        return;
+    }
+    ++obj->ref_count;
+}
+
+static inline void NEO_dereference(NeoObject *obj) {
+    if (obj == NULL || obj->ref_count <= 0 || obj->prototype == NeoBoolean) {
+        return;
+    }
+    --obj->ref_count;
+    if (obj->ref_count == 0) {
+        NEO_free_unsafe(obj);
+    }
+}
+
+NeoObject *NEO_immortal(NeoObject *obj);
+
+void NEO_free_immortal(NeoObject *obj);
 
 bool NEO_get_truthy(NeoObject *obj);
 
@@ -201,6 +225,55 @@ NeoObject *NEO_less_or_equals(NeoObject *a, NeoObject *b);
 
 NeoObject *NEO_not(NeoObject *a);
 
+NeoObject *NEO_negate(NeoObject *a);
+
+// Native values, the ints and doubles compiled code keeps in C variables. A value that is neither is kept in a box
+// next to the variable, the box is NULL while the C value is the one.
+
+// A new reference to the value.
+NeoObject *NEO_box_int(int64_t value, NeoObject *box);
+
+NeoObject *NEO_box_double(double value, NeoObject *box);
+
+// Takes obj over, an int is stored in value and freed, the box of anything else is obj.
+NeoObject *NEO_unbox_int(NeoObject *obj, int64_t *value);
+
+NeoObject *NEO_unbox_double(NeoObject *obj, double *value);
+
+// operation on objects that are dereferenced after.
+NeoObject *NEO_apply(NeoObject *(*operation)(NeoObject *, NeoObject *), NeoObject *a, NeoObject *b);
+
+NeoObject *NEO_apply_unary(NeoObject *(*operation)(NeoObject *), NeoObject *a);
+
+// NEO_get_truthy of an object that is dereferenced after.
+bool NEO_take_truthy(NeoObject *obj);
+
+// a op b of native ints, false when the result is not one the runtime makes, which computes ints in a C int.
+// The runtime is left to do those.
+static inline bool NEO_native_add(int64_t a, int64_t b, int64_t *result) {
+    return !__builtin_add_overflow(a, b, result) && *result == (int) *result;
+}
+
+static inline bool NEO_native_subtract(int64_t a, int64_t b, int64_t *result) {
+    return !__builtin_sub_overflow(a, b, result) && *result == (int) *result;
+}
+
+static inline bool NEO_native_multiply(int64_t a, int64_t b, int64_t *result) {
+    return !__builtin_mul_overflow(a, b, result) && *result == (int) *result;
+}
+
+static inline bool NEO_native_modulo(int64_t a, int64_t b, int64_t *result) {
+    if (b == 0) {
+        return false;
+    }
+    *result = a % b;
+    return true;
+}
+
+static inline bool NEO_native_negate(int64_t a, int64_t *result) {
+    return NEO_native_subtract(0, a, result);
+}
+
 NeoObject *NEO_call(
         NeoObject *obj, NeoObject *baseObject, NeoObject **args, size_t arg_count, NeoHashMap *kwargs);
 
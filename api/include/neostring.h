@@ -9,4 +9,6 @@ NeoObject *NEO_string2(char *string);
 
 NeoObject *NEO_string3(char *string);
 
+NeoObject *NEO_string_add(NeoObject *a, NeoObject *b);
+
 #endif
\ No newline at end of file
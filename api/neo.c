@@ -149,21 +149,13 @@ void NEO_free_unsafe(NeoObject *obj) {
     free(obj);
 }
 
-void NEO_dereference(NeoObject *obj) {
-    if (obj == NULL || obj->ref_count <= 0 || obj->prototype == NeoBoolean) {
-        return;
-    }
-    --obj->ref_count;
-    if (obj->ref_count == 0) {
-        NEO_free_unsafe(obj);
-    }
+NeoObject *NEO_immortal(NeoObject *obj) {
+    obj->ref_count = NEO_IMMORTAL;
+    return obj;
 }
 
-void NEO_reference(NeoObject *obj) {
-    if (obj == NULL || obj->prototype == NeoBoolean) {
-        return;
-    }
-    ++obj->ref_count;
+void NEO_free_immortal(NeoObject *obj) {
+    NEO_free_unsafe(obj);
 }
 
 bool NEO_get_truthy(NeoObject *obj) {
@@ -374,7 +366,26 @@ NeoObject *NEO_glob_input(
         return NEO_call_object_property(a, key, a, args, 1, NeoEmptyHashmap);  \
     }
 
-NEO_DefineOperation(add, "__add__")
+NeoObject *NEO_add(NeoObject *a, NeoObject *b) {
+    if (a->prototype == NeoString) {
+        return NEO_string_add(a, b);
+    }
+    if (a->prototype == NeoInt) {
+        return NEO_int_add(a, b);
+    }
+    if (a->prototype == NeoDouble) {
+        return NEO_double_add(a, b);
+    }
+    if (a->prototype == NeoBigInt) {
+        return NEO_bigint_add(a, b);
+    }
+    if (a->prototype == NeoBigFloat) {
+        return NEO_bigfloat_add(a, b);
+    }
+    NeoObject **args = malloc(sizeof(NeoObject *));
+    args[0] = b;
+    return NEO_call_object_property(a, "__add__", a, args, 1, NeoEmptyHashmap);
+}
 
 NEO_DefineOperation(subtract, "__sub__")
 
@@ -465,20 +476,73 @@ NeoObject *NEO_less_or_equals(NeoObject *a, NeoObject *b) {
 
 NeoObject *NEO_negate(NeoObject *a) {
     if (a->prototype == NeoInt) {
-        return NEO_int_not(a);
+        return NEO_int_negate(a);
     }
     if (a->prototype == NeoDouble) {
-        return NEO_double_not(a);
+        return NEO_double_negate(a);
     }
     if (a->prototype == NeoBigInt) {
-        return NEO_bigint_not(a);
+        return NEO_bigint_negate(a);
     }
     if (a->prototype == NeoBigFloat) {
-        return NEO_bigfloat_not(a);
+        return NEO_bigfloat_negate(a);
     }
     return NEO_call_object_property(a, "__negate__", a, NULL, 0, NeoEmptyHashmap);
 }
 
+NeoObject *NEO_box_int(int64_t value, NeoObject *box) {
+    if (box != NULL) {
+        NEO_reference(box);
+        return box;
+    }
+    return NEO_int(value);
+}
+
+NeoObject *NEO_box_double(double value, NeoObject *box) {
+    if (box != NULL) {
+        NEO_reference(box);
+        return box;
+    }
+    return NEO_double(value);
+}
+
+NeoObject *NEO_unbox_int(NeoObject *obj, int64_t *value) {
+    if (obj == NULL || obj->prototype != NeoInt) {
+        return obj;
+    }
+    *value = NEO_vInt(obj);
+    NEO_dereference(obj);
+    return NULL;
+}
+
+NeoObject *NEO_unbox_double(NeoObject *obj, double *value) {
+    if (obj == NULL || obj->prototype != NeoDouble) {
+        return obj;
+    }
+    *value = NEO_vDouble(obj);
+    NEO_dereference(obj);
+    return NULL;
+}
+
+NeoObject *NEO_apply(NeoObject *(*operation)(NeoObject *, NeoObject *), NeoObject *a, NeoObject *b) {
+    NeoObject *result = operation(a, b);
+    NEO_dereference(a);
+    NEO_dereference(b);
+    return result;
+}
+
+NeoObject *NEO_apply_unary(NeoObject *(*operation)(NeoObject *), NeoObject *a) {
+    NeoObject *result = operation(a);
+    NEO_dereference(a);
+    return result;
+}
+
+bool NEO_take_truthy(NeoObject *obj) {
+    bool truthy = NEO_get_truthy(obj);
+    NEO_dereference(obj);
+    return truthy;
+}
+
 NeoObject *NEO_call(
         NeoObject *obj, NeoObject *baseObject, NeoObject **args, size_t arg_count, NeoHashMap *kwargs) {
     if (obj->call == NULL) {
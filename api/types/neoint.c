@@ -2,7 +2,7 @@
 
 #define NEO_int_add_overflow(a, b) ((a > 0 && b > 0 && a > INT64_MAX - b) || (a < 0 && b < 0 && a < INT64_MIN - b))
 #define NEO_int_subtract_overflow(a, b) ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b))
-#define NEO_int_multiply_overflow(a, b) ((a > 0 && b > 0 && a > INT64_MAX / b) || (a < 0 && b < 0 && a < INT64_MIN / b))
+#define NEO_int_multiply_overflow(a, b) ((a > 0 && b > 0 && a > INT64_MAX / b) || (a < 0 && b < 0 && a < INT64_MAX / b))
 
 NeoObject *NEO_int(int number) {
     NeoObject *obj = NEO_object_unset();
@@ -29,4 +29,17 @@ NeoObject *NEO_string3(char *string) {
     v->length = strlen(string);
     obj->v = v;
     return obj;
-}
\ No newline at end of file
+}
+
+NeoObject *NEO_string_add(NeoObject *a, NeoObject *b) {
+    if (b->prototype != NeoString) {
+        NEO_throw_error("RuntimeError: string + object is not supported.");
+    }
+    NeoStringValue *a_value = NEO_vString(a);
+    NeoStringValue *b_value = NEO_vString(b);
+    size_t length = a_value->length + b_value->length;
+    char *string = malloc(length + 1);
+    memcpy(string, a_value->value, a_value->length);
+    memcpy(string + a_value->length, b_value->value, b_value->length + 1);
+    return NEO_string(string, length);
+}
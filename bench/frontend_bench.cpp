@@ -0,0 +1,410 @@
+// Front end throughput benchmark, times tokenize, groupTokens, parse, the JSON dump of the tree and code generation
+// on their own.
+// usage: neo_bench_frontend [--size N[K|M]]... [--iterations N] [--depth N] [--statements N] [--terms N]
+//                           [--literals PERCENT] [--threads N] [--emit FILE] [FILE]...
+// Without files a synthetic program is generated for every --size (1K, 64K, 1M and 16M by default, up to 100M).
+// The mix of the synthetic program: --depth is how deep blocks nest inside a function, --statements how many
+// statements each block holds, --terms how many operands an expression has and --literals how many of those
+// operands are literals rather than variables. --threads is how many threads parse function bodies, one per core by
+// default. --emit writes the first generated program to FILE and exits.
+// Every phase prints one JSON object per line, with the best time over the iterations:
+//   {"input": ..., "bytes": ..., "tokens": ..., "phase": ..., "seconds": ..., "mb_per_s": ..., "tokens_per_s": ...,
+//    "allocations": ..., "allocated_bytes": ..., "arena_bytes": ..., "peak_rss_kb": ...}
+// allocations and allocated_bytes count operator new during the phase, arena_bytes what the phase took from the
+// arena. Build with -DCMAKE_BUILD_TYPE=Release to get meaningful numbers.
+
+#include "compiler.hpp"
+#include "dump.hpp"
+#include "error.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sys/resource.h>
+
+using namespace std;
+
+static atomic<size_t> allocationCount(0);
+static atomic<size_t> allocatedBytes(0);
+
+void *operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    allocatedBytes.fetch_add(size, memory_order_relaxed);
+    if (auto pointer = malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    free(pointer);
+}
+
+typedef struct {
+    int depth = 2;
+    int statements = 4;
+    int terms = 4;
+    int literals = 50;
+} CorpusMix;
+
+class CorpusGenerator {
+public:
+    CorpusGenerator(CorpusMix mix) : mix(mix) {};
+
+    CorpusMix mix;
+    string code;
+    unsigned state = 1;
+    size_t functionCount = 0;
+
+    string generate(size_t size) {
+        code.clear();
+        code.reserve(size + 4096);
+        functionCount = 0;
+        while (code.size() < size) {
+            function();
+        }
+        return std::move(code);
+    }
+
+private:
+    unsigned random(unsigned bound) {
+        // deterministic, so the same flags always give the same program
+        state = state * 1103515245 + 12345;
+        return (state >> 16) % bound;
+    }
+
+    void indent(int level) {
+        code.append(level * 4, ' ');
+    }
+
+    void operand(int variables) {
+        if (variables == 0 || (int) random(100) < mix.literals) {
+            switch (random(4)) {
+                case 0:
+                    code += to_string(random(100000));
+                    break;
+                case 1:
+                    code += to_string(random(1000)) + "." + to_string(random(100));
+                    break;
+                case 2:
+                    code += "\"text " + to_string(random(1000)) + "\"";
+                    break;
+                default:
+                    code += to_string(random(1000000)) + "n";
+                    break;
+            }
+        } else {
+            code += "v" + to_string(random(variables));
+        }
+    }
+
+    void expression(int variables) {
+        static const char *operators[] = {" + ", " - ", " * ", " / ", " % ", " << ", " & ", " | "};
+        for (int i = 0; i < mix.terms; i++) {
+            if (i > 0) {
+                code += operators[random(8)];
+            }
+            if (mix.terms > 2 && i == 1 && random(2) == 0) {
+                code += "(";
+                operand(variables);
+                code += operators[random(8)];
+                operand(variables);
+                code += ")";
+            } else {
+                operand(variables);
+            }
+        }
+    }
+
+    void condition(int variables) {
+        static const char *comparisons[] = {" < ", " <= ", " > ", " >= ", " == ", " != "};
+        operand(variables);
+        code += comparisons[random(6)];
+        operand(variables);
+        if (random(2) == 0) {
+            code += random(2) == 0 ? " && " : " || ";
+            operand(variables);
+            code += comparisons[random(6)];
+            operand(variables);
+        }
+    }
+
+    void block(int level, int variables) {
+        // locals of nested blocks are not visible to the outer ones, so only those declared around are used
+        auto declared = variables;
+        for (int i = 0; i < mix.statements; i++) {
+            indent(level);
+            auto kind = random(level <= mix.depth ? 6 : 3);
+            if (kind == 0 || declared == 0) {
+                code += "let v" + to_string(declared++) + " = ";
+                expression(declared - 1);
+            } else if (kind == 1) {
+                code += "v" + to_string(random(declared)) + " = ";
+                expression(declared);
+            } else if (kind == 2) {
+                code += "print(";
+                expression(declared);
+                code += ")";
+            } else if (kind == 3) {
+                code += "if (";
+                condition(declared);
+                code += ") {\n";
+                block(level + 1, declared);
+                indent(level);
+                code += "} else {\n";
+                block(level + 1, declared);
+                indent(level);
+                code += "}";
+            } else if (kind == 4) {
+                // the compiler has no while loops yet, and a loop ends the block it is in
+                code += "if (";
+                condition(declared);
+                code += ") {\n";
+                block(level + 1, declared);
+                indent(level);
+                code += "}";
+            } else {
+                code += "do {\n";
+                block(level + 1, declared);
+                indent(level);
+                code += "}";
+            }
+            code += "\n";
+        }
+    }
+
+    void function() {
+        auto name = "f" + to_string(functionCount++);
+        code += "fn " + name + "(a, b) {\n";
+        block(1, 0);
+        code += "    return v0\n}\n";
+        code += "let r" + to_string(functionCount) + " = " + name + "(";
+        operand(0);
+        code += ", ";
+        operand(0);
+        code += ")\n\n";
+    }
+};
+
+static size_t parseSize(const string &text) {
+    size_t multiplier = 1;
+    auto digits = text;
+    if (!digits.empty() && (digits.back() == 'K' || digits.back() == 'k')) {
+        multiplier = 1024;
+        digits.pop_back();
+    } else if (!digits.empty() && (digits.back() == 'M' || digits.back() == 'm')) {
+        multiplier = 1024 * 1024;
+        digits.pop_back();
+    }
+    return stoull(digits) * multiplier;
+}
+
+static long peakRss() {
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static string jsonString(const string &text) {
+    string result = "\"";
+    for (auto c: text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+typedef struct {
+    double seconds = 1e100;
+    size_t allocations = 0;
+    size_t allocatedBytes = 0;
+    size_t arenaBytes = 0;
+} PhaseResult;
+
+class PhaseTimer {
+public:
+    PhaseTimer(PhaseResult &result, Arena &arena) : result(result), arena(arena) {
+        allocations = allocationCount.load();
+        bytes = allocatedBytes.load();
+        arenaUsed = arena.used();
+        start = chrono::steady_clock::now();
+    }
+
+    ~PhaseTimer() {
+        auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (seconds < result.seconds) {
+            result.seconds = seconds;
+        }
+        // the same work every iteration, so the counts of the last one stand for all of them
+        result.allocations = allocationCount.load() - allocations;
+        result.allocatedBytes = allocatedBytes.load() - bytes;
+        result.arenaBytes = arena.used() - arenaUsed;
+    }
+
+private:
+    PhaseResult &result;
+    Arena &arena;
+    size_t allocations;
+    size_t bytes;
+    size_t arenaUsed;
+    chrono::steady_clock::time_point start;
+};
+
+// Counts what is written and drops it, so the dump and generate phases time the writer rather than a disk.
+class DiscardBuffer : public streambuf {
+public:
+    size_t written = 0;
+
+protected:
+    int overflow(int chr) override {
+        written++;
+        return chr;
+    }
+
+    streamsize xsputn(const char *, streamsize count) override {
+        written += count;
+        return count;
+    }
+};
+
+static void benchmark(const string &name, const shared_ptr<Source> &source, int iterations, unsigned threads) {
+    PhaseResult tokenize, group, parse, dump, generate;
+    size_t tokenCount = 0;
+    for (int i = 0; i < iterations; i++) {
+        Arena arena;
+        auto parser = Parser(Lexer(source, &arena));
+        parser.threads = threads;
+        {
+            PhaseTimer timer(tokenize, arena);
+            parser.lexer.tokenize();
+        }
+        tokenCount = parser.lexer.tokens.size();
+        {
+            PhaseTimer timer(group, arena);
+            parser.lexer.groupTokens();
+        }
+        if (diagnostics.hasErrors()) {
+            diagnostics.flush();
+            exit(1);
+        }
+        {
+            PhaseTimer timer(parse, arena);
+            parser.parse();
+        }
+        {
+            DiscardBuffer buffer;
+            ostream out(&buffer);
+            PhaseTimer timer(dump, arena);
+            JsonWriter json(out);
+            writeNodes(json, parser.ast, parser.statements());
+        }
+        Compiler compiler(parser);
+        {
+            DiscardBuffer buffer;
+            ostream out(&buffer);
+            PhaseTimer timer(generate, arena);
+            compiler.build();
+            compiler.write(out);
+        }
+        if (diagnostics.hasErrors()) {
+            diagnostics.flush();
+            exit(1);
+        }
+    }
+
+    auto mb = (double) source->code.size() / (1024 * 1024);
+    pair<const char *, PhaseResult *> phases[] = {
+            {"tokenize",    &tokenize},
+            {"groupTokens", &group},
+            {"parse",       &parse},
+            {"dump",        &dump},
+            {"generate",    &generate}
+    };
+    for (auto &phase: phases) {
+        auto &result = *phase.second;
+        cout << "{\"input\": " << jsonString(name) << ", \"bytes\": " << source->code.size()
+             << ", \"tokens\": " << tokenCount << ", \"phase\": \"" << phase.first << "\""
+             << ", \"seconds\": " << result.seconds << ", \"mb_per_s\": " << mb / result.seconds
+             << ", \"tokens_per_s\": " << tokenCount / result.seconds
+             << ", \"allocations\": " << result.allocations << ", \"allocated_bytes\": " << result.allocatedBytes
+             << ", \"arena_bytes\": " << result.arenaBytes << ", \"peak_rss_kb\": " << peakRss() << "}" << endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    CorpusMix mix;
+    vector<size_t> sizes;
+    vector<string> files;
+    string emit;
+    int iterations = 5;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        auto value = [&]() -> string {
+            if (i + 1 >= argc) {
+                cout << "error: " << argument << " expects a value" << endl;
+                exit(1);
+            }
+            return argv[++i];
+        };
+        if (argument == "--size") {
+            sizes.push_back(parseSize(value()));
+        } else if (argument == "--iterations") {
+            iterations = stoi(value());
+        } else if (argument == "--depth") {
+            mix.depth = stoi(value());
+        } else if (argument == "--statements") {
+            mix.statements = stoi(value());
+        } else if (argument == "--terms") {
+            mix.terms = stoi(value());
+        } else if (argument == "--literals") {
+            mix.literals = stoi(value());
+        } else if (argument == "--threads") {
+            threads = stoi(value());
+        } else if (argument == "--emit") {
+            emit = value();
+        } else {
+            files.push_back(argument);
+        }
+    }
+    if (mix.statements < 1 || mix.terms < 1 || iterations < 1) {
+        cout << "error: --statements, --terms and --iterations must be at least 1" << endl;
+        return 1;
+    }
+    if (sizes.empty()) {
+        sizes = {1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    }
+
+    for (auto &file: files) {
+        auto source = Source::load(file);
+        if (source == nullptr) {
+            cout << "error: could not open file '" << file << "'" << endl;
+            return 1;
+        }
+        benchmark(file, source, iterations, threads);
+    }
+    if (!files.empty()) {
+        return 0;
+    }
+
+    CorpusGenerator generator(mix);
+    for (auto size: sizes) {
+        auto name = "<synthetic " + to_string(size) + ">";
+        auto source = make_shared<Source>(name, generator.generate(size));
+        if (!emit.empty()) {
+            ofstream(emit, ios::binary) << source->code;
+            return 0;
+        }
+        benchmark(name, source, iterations, threads);
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Lexer throughput benchmark.
+// usage: neo_bench_lexer [file] [iterations]
+// Without a file a synthetic ~16 MB program is lexed. Build with -DCMAKE_BUILD_TYPE=Release (and -mavx2 for the
+// AVX2 scanners) to get meaningful numbers.
+
+#include "lexer.hpp"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+string syntheticProgram(size_t size) {
+    const string chunk =
+            "// synthetic benchmark input\n"
+            "let counter_value = 1234567 + 0.5 * variable_name_with_length\n"
+            "fn compute_something(first_argument, second_argument) {\n"
+            "    /* block comment describing the body of the function */\n"
+            "    let result = first_argument ** 2 + second_argument << 3\n"
+            "    if (result >= 100 && result != 200) {\n"
+            "        result += \"a string literal with some words in it\"\n"
+            "    }\n"
+            "    return [result, {key: 'value', other_key: 42n}]\n"
+            "}\n"
+            "compute_something(counter_value, 99).property[0]\n\n";
+    string code;
+    code.reserve(size + chunk.size());
+    while (code.size() < size) {
+        code += chunk;
+    }
+    return code;
+}
+
+int main(int argc, char *argv[]) {
+    shared_ptr<Source> source;
+    if (argc > 1) {
+        source = Source::load(argv[1]);
+        if (source == nullptr) {
+            cout << "error: could not open file '" << argv[1] << "'" << endl;
+            return 1;
+        }
+    } else {
+        source = make_shared<Source>("<synthetic>", syntheticProgram(16 * 1024 * 1024));
+    }
+    int iterations = argc > 2 ? stoi(argv[2]) : 10;
+
+    double best = 1e100;
+    size_t tokenCount = 0;
+    for (int i = 0; i < iterations; i++) {
+        Arena arena;
+        auto lexer = Lexer(source, &arena);
+        auto start = chrono::steady_clock::now();
+        lexer.tokenize();
+        auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        best = min(best, seconds);
+        tokenCount = lexer.tokens.size();
+    }
+
+    auto mb = (double) source->code.size() / (1024 * 1024);
+    cout << "input: " << mb << " MB, " << tokenCount << " tokens" << endl;
+    cout << "tokenize: " << best * 1000 << " ms, " << mb / best << " MB/s, " << tokenCount / best / 1e6
+         << " Mtokens/s" << endl;
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef NEO_ARENA_HPP
+#define NEO_ARENA_HPP
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Bump allocator, everything allocated from it is released at once by reset() or when it is destroyed.
+// Destructors are never run, so only trivially destructible objects should live in it.
+class Arena {
+public:
+    explicit Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {};
+
+    Arena(const Arena &) = delete;
+
+    Arena &operator=(const Arena &) = delete;
+
+    ~Arena();
+
+    void *allocate(size_t size, size_t align = alignof(max_align_t));
+
+    template<typename T, typename... Args>
+    T *make(Args &&... args) {
+        return new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    T *makeArray(size_t count) {
+        return count == 0 ? nullptr : (T *) allocate(sizeof(T) * count, alignof(T));
+    }
+
+    void reset();
+
+    size_t used() const;
+
+private:
+    vector<char *> blocks;
+    char *cursor = nullptr;
+    char *limit = nullptr;
+    size_t blockSize;
+    size_t usedBefore = 0; // bytes used by the blocks before the current one
+};
+
+#endif //NEO_ARENA_HPP
@@ -0,0 +1,152 @@
+#ifndef NEO_AST_HPP
+#define NEO_AST_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "lexer.hpp"
+
+using namespace std;
+
+typedef uint32_t NodeId;
+
+#define NO_NODE 0xFFFFFFFFu
+
+typedef enum : uint8_t {
+    S_VARIABLE_DECLARATION,
+    S_FUNCTION_DECLARATION,
+    S_DO,
+    S_LOOP,
+    S_WHILE,
+    S_DO_WHILE,
+    S_FOR_ITERATOR,
+    S_FOR_CLASSIC,
+    S_RETURN,
+    S_BREAK,
+    S_CONTINUE,
+    S_CLASS_DEFINITION,
+    S_IF_FLOW,
+    S_IMPORT,
+    S_EXPRESSION,
+
+    E_LITERAL,
+    E_IDENTIFIER,
+    E_ARRAY,
+    E_OBJECT,
+    E_PROPERTY,
+    E_UNARY,
+    E_BINARY,
+    E_ASSIGNMENT,
+    E_UPDATE,
+    E_MEMBER,
+    E_INDEX,
+    E_CALL,
+    E_KEYWORD_ARGUMENT,
+
+    NODE_KIND_COUNT
+} NodeKind;
+
+#define IsStatementNode(kind) ((kind) <= S_EXPRESSION)
+
+// flags
+#define F_CONSTANT 1 // const declarations
+#define F_PREFIX 1 // ++x rather than x++
+#define F_PATTERN 1 // arrays and objects on the left of =, which destructure the value
+
+// A view of contiguous node ids, every child list of the tree is one.
+class NodeList {
+public:
+    NodeList() : items(nullptr), count(0) {};
+
+    NodeList(const NodeId *items, size_t count) : items(items), count(count) {};
+
+    const NodeId *items;
+    size_t count;
+
+    size_t size() const { return count; };
+
+    bool empty() const { return count == 0; };
+
+    NodeId operator[](size_t i) const { return items[i]; };
+
+    const NodeId *begin() const { return items; };
+
+    const NodeId *end() const { return items + count; };
+
+    NodeId back() const { return items[count - 1]; };
+};
+
+// The statements and expressions of a source, a node is an index into parallel arrays. A list of nodes is a slot,
+// two words of extra holding where its ids start in extra and how many there are. What lhs and rhs hold by kind,
+// NO_NODE where a node is left out:
+//   S_VARIABLE_DECLARATION  token name, lhs value, flags F_CONSTANT
+//   S_FUNCTION_DECLARATION  token name, lhs where extra holds the parameter count and a (start, count) run of
+//                           tokenLists for each parameter, rhs body slot
+//   S_DO, S_LOOP            lhs body slot
+//   S_WHILE, S_DO_WHILE     lhs condition, rhs body slot
+//   S_FOR_ITERATOR          token index, lhs iterator, rhs body slot, then extra[rhs + 2] is the value in tokenLists
+//   S_FOR_CLASSIC           lhs condition, rhs body slot, then the init and the iterator statement
+//   S_RETURN                lhs value
+//   S_CLASS_DEFINITION      lhs attributes slot, rhs methods slot
+//   S_IF_FLOW               lhs condition, rhs body slot, the else body slot right after it
+//   S_IMPORT                token name, lhs where extra holds a (start, count) run of tokenLists
+//   S_EXPRESSION            lhs expression
+//   E_LITERAL, E_IDENTIFIER token
+//   E_ARRAY                 token group, lhs elements slot, flags F_PATTERN
+//   E_OBJECT                token group, lhs slot of E_PROPERTY nodes, flags F_PATTERN
+//   E_PROPERTY              token key (an identifier, a string or a [] group), lhs computed key, rhs value, the
+//                           target in a pattern
+//   E_UNARY                 token operator, lhs operand
+//   E_BINARY                token operator, lhs and rhs operands
+//   E_ASSIGNMENT            token operator, lhs target, rhs value
+//   E_UPDATE                token operator, lhs target, flags F_PREFIX
+//   E_MEMBER                token name, lhs object
+//   E_INDEX                 token [] group, lhs object, rhs key
+//   E_CALL                  token () group, lhs callee, rhs arguments slot, in source order
+//   E_KEYWORD_ARGUMENT      token keyword, lhs value
+// Nothing points back at its parent and nothing is freed on its own, a block parsed again gets new nodes and its
+// slot is pointed at them. The arrays are all there is to it, so the tree goes away at once and can be written out
+// as it is, tokens aside.
+class Ast {
+public:
+    vector<NodeKind> kinds;
+    vector<uint8_t> flags;
+    vector<Token *> tokens;
+    vector<uint32_t> lhs;
+    vector<uint32_t> rhs;
+    vector<uint32_t> extra;
+    vector<Token *> tokenLists;
+    // ids of the lists being built, innermost last, see beginList and endList
+    vector<NodeId> scratch;
+
+    size_t size() const { return kinds.size(); };
+
+    void clear();
+
+    NodeId add(NodeKind kind, Token *token, uint32_t lhs = NO_NODE, uint32_t rhs = NO_NODE, uint8_t flags = 0);
+
+    // Reserves words of extra, an empty list slot for each pair, returns where they start.
+    uint32_t reserve(size_t words);
+
+    // Lists are built on scratch, beginList returns the mark endList moves everything after into slot.
+    size_t beginList() const { return scratch.size(); };
+
+    void endList(size_t mark, uint32_t slot);
+
+    NodeList list(uint32_t slot) const {
+        return NodeList(extra.data() + extra[slot], extra[slot + 1]);
+    };
+
+    // Stores runs of tokens in tokenLists, returns where they start.
+    uint32_t addTokens(TokenList tokens);
+
+    TokenList tokenList(uint32_t start, uint32_t count) const {
+        return TokenList((Token **) tokenLists.data() + start, count);
+    };
+
+    // Moves the nodes of a tree built on its own to the end of this one, renumbering what they point at. slots are
+    // lists of part no node points at that are renumbered too. Returns where the extra words of part start now.
+    uint32_t append(const Ast &part, const vector<uint32_t> &slots);
+};
+
+#endif //NEO_AST_HPP
@@ -0,0 +1,81 @@
+#ifndef NEO_ATOM_HPP
+#define NEO_ATOM_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "arena.hpp"
+
+using namespace std;
+
+// An interned identifier, the same name is always the same atom so names compare as integers.
+typedef uint32_t Atom;
+
+// Atoms the front end looks for, interned first so their values are fixed.
+// The keywords come first and in the same order as the lexer's keyword list.
+typedef enum {
+    A_NONE,
+    A_LET,
+    A_CONST,
+    A_IF,
+    A_FOR,
+    A_LOOP,
+    A_WHILE,
+    A_RETURN,
+    A_BREAK,
+    A_CONTINUE,
+    A_FN,
+    A_CLASS,
+    A_IMPORT,
+    A_IN,
+    A_SWITCH,
+    A_MATCH,
+    A_CASE,
+    A_DEFAULT,
+    A_THROW,
+    A_DO,
+    A_ELSE,
+    A_FROM,
+    A_PRINT,
+    A_INPUT,
+    A_TRUE,
+    A_FALSE,
+    A_PREDEFINED_COUNT
+} PredefinedAtom;
+
+constexpr string_view predefinedAtomNames[] = {"", "let", "const", "if", "for", "loop", "while", "return", "break",
+                                               "continue", "fn", "class", "import", "in", "switch", "match", "case",
+                                               "default", "throw", "do", "else", "from", "print", "input", "true",
+                                               "false"};
+
+static_assert(sizeof(predefinedAtomNames) / sizeof(predefinedAtomNames[0]) == A_PREDEFINED_COUNT,
+              "every predefined atom needs a name");
+
+// Open addressing table from names to atoms. Names are copied in on first sight, so atoms outlive the sources.
+class AtomTable {
+public:
+    AtomTable();
+
+    AtomTable(const AtomTable &) = delete;
+
+    AtomTable &operator=(const AtomTable &) = delete;
+
+    Atom intern(string_view name);
+
+    string_view name(Atom atom) const { return names[atom]; };
+
+    size_t size() const { return names.size(); };
+
+private:
+    vector<Atom> slots; // A_NONE marks an empty slot, the size is a power of two
+    vector<string_view> names; // indexed by atom, point into storage
+    vector<uint32_t> hashes;
+    Arena storage;
+
+    void grow();
+};
+
+// Shared by the lexer, the parser and the compiler.
+extern AtomTable atomTable;
+
+#endif //NEO_ATOM_HPP
@@ -0,0 +1,34 @@
+#ifndef NEO_BUILDCACHE_HPP
+#define NEO_BUILDCACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define BUILD_CACHE_DIRECTORY "output/.cache/build"
+
+// Binaries compiled from generated C, keyed by a hash of the C, the command compiling it and the runtime it is
+// compiled or linked with, so running an unchanged program again skips the C compiler.
+class BuildCache {
+public:
+    explicit BuildCache(string directory = BUILD_CACHE_DIRECTORY) : directory(std::move(directory)) {};
+
+    string directory;
+
+    // The key of the build of code with the hash codeHash, by command against runtime, where a file is taken
+    // whole and a directory by the sources under it.
+    static uint64_t key(uint64_t codeHash, const string &command, const vector<string> &runtime);
+
+    // Puts the binary stored for key at binary, false if there is none.
+    bool load(uint64_t key, const string &binary) const;
+
+    // Stores binary for key, failing to is not an error.
+    void save(uint64_t key, const string &binary) const;
+
+private:
+    string entryPath(uint64_t key) const;
+};
+
+#endif //NEO_BUILDCACHE_HPP
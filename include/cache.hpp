@@ -0,0 +1,33 @@
+#ifndef NEO_CACHE_HPP
+#define NEO_CACHE_HPP
+
+#include "lexer.hpp"
+#include "parser.hpp"
+
+using namespace std;
+
+#define PARSE_CACHE_DIRECTORY "output/.cache/front"
+
+// Bump when the tokens or statements the front end produces change, older entries are ignored then.
+#define PARSE_CACHE_VERSION 3
+
+// On disk cache of the grouped tokens and the statements parsed from a source, keyed by a hash of its content.
+// An entry is mapped and turned back into tokens with one allocation for all of them, the token values point into
+// the source again, so unchanged files skip tokenize, groupTokens and parse.
+class ParseCache {
+public:
+    explicit ParseCache(string directory = PARSE_CACHE_DIRECTORY) : directory(std::move(directory)) {};
+
+    string directory;
+
+    // Fills the tokens of parser.lexer and the statements of parser, false if there is no usable entry.
+    bool load(Parser &parser) const;
+
+    // Stores what parser holds after a successful parse, failing to write is not an error.
+    void save(Parser &parser) const;
+
+private:
+    string entryPath(const Source *source) const;
+};
+
+#endif //NEO_CACHE_HPP
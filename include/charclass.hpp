@@ -0,0 +1,51 @@
+#ifndef NEO_CHARCLASS_HPP
+#define NEO_CHARCLASS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+typedef enum : uint8_t {
+    C_WHITESPACE = 1 << 0, // ' ' \t \r \v, new lines are tokens
+    C_DIGIT = 1 << 1,
+    C_IDENTIFIER_START = 1 << 2, // a-z A-Z _
+    C_IDENTIFIER = 1 << 3, // a-z A-Z 0-9 _
+    C_SYMBOL = 1 << 4, // . , : ; and backslash
+    C_PAREN = 1 << 5, // ( ) [ ] { }
+    C_OPERATOR = 1 << 6 // + - * / % & | ^ ~ > < ! =
+} CharClass;
+
+constexpr array<uint8_t, 256> makeCharClassTable() {
+    array<uint8_t, 256> table{};
+    for (int c = 'a'; c <= 'z'; c++) table[c] |= C_IDENTIFIER_START | C_IDENTIFIER;
+    for (int c = 'A'; c <= 'Z'; c++) table[c] |= C_IDENTIFIER_START | C_IDENTIFIER;
+    for (int c = '0'; c <= '9'; c++) table[c] |= C_DIGIT | C_IDENTIFIER;
+    table['_'] |= C_IDENTIFIER_START | C_IDENTIFIER;
+    for (auto c: " \t\r\v") if (c) table[(uint8_t) c] |= C_WHITESPACE;
+    for (auto c: ".,:;\\") if (c) table[(uint8_t) c] |= C_SYMBOL;
+    for (auto c: "()[]{}") if (c) table[(uint8_t) c] |= C_PAREN;
+    for (auto c: "+-*/%&|^~><!=") if (c) table[(uint8_t) c] |= C_OPERATOR;
+    return table;
+}
+
+constexpr array<uint8_t, 256> charClassTable = makeCharClassTable();
+
+inline bool isCharClass(char chr, uint8_t cls) {
+    return charClassTable[(uint8_t) chr] & cls;
+}
+
+// Run scanners, each returns the first position in [p, end) that doesn't belong to the run (or end).
+// They are vectorized with AVX2 or SSE2 when the compiler targets them.
+
+const char *skipWhitespace(const char *p, const char *end);
+
+const char *skipIdentifier(const char *p, const char *end);
+
+const char *skipDigits(const char *p, const char *end);
+
+// first position of a or b
+const char *findEither(const char *p, const char *end, char a, char b);
+
+#endif //NEO_CHARCLASS_HPP
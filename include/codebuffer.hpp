@@ -0,0 +1,39 @@
+#ifndef NEO_CODEBUFFER_HPP
+#define NEO_CODEBUFFER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Generated code that is only ever appended to. What isn't known yet, like the function a call goes to, is left as
+// a placeholder for a symbol and filled in when the code is written out, so nothing is inserted in the middle.
+class CodeBuffer {
+public:
+    CodeBuffer &operator+=(string_view code) {
+        text.append(code);
+        return *this;
+    };
+
+    // Marks the current end for symbol.
+    void placeholder(uint32_t symbol) { placeholders.push_back({text.size(), symbol}); };
+
+    // Writes the code with each placeholder replaced by symbols[symbol].
+    void write(ostream &out, const vector<string> &symbols) const;
+
+    size_t size() const { return text.size(); };
+
+private:
+    typedef struct {
+        size_t offset;
+        uint32_t symbol;
+    } Placeholder;
+
+    string text;
+    vector<Placeholder> placeholders; // in the order of their offsets
+};
+
+#endif //NEO_CODEBUFFER_HPP
@@ -1,8 +1,14 @@
 #ifndef NEO_COMPILER_HPP
 #define NEO_COMPILER_HPP
 
+#include "codebuffer.hpp"
+#include "inference.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <ostream>
 #include <sstream>
 #include <unordered_map>
 
@@ -10,6 +16,38 @@ using namespace std;
 
 class Compiler;
 
+typedef enum {
+    CTV_TEMP,
+    CTV_VARIABLE,
+    CTV_INVALID_VARIABLE,
+    CTV_NULL,
+    CTV_CONSTANT, // known at compile time and not written yet, see Compiler::materialize
+    CTV_NATIVE, // a C value, its box is dereferenced after use like a temp
+    CTV_NATIVE_VARIABLE // a variable kept in a C local, see TypeInference
+} CTV_Type;
+
+typedef enum {
+    CONSTANT_INT,
+    CONSTANT_DOUBLE,
+    CONSTANT_STRING
+} ConstantType;
+
+// A value known at compile time, with the runtime type it has.
+typedef struct {
+    ConstantType type = CONSTANT_INT;
+    int64_t integer = 0;
+    double number = 0;
+    string_view literal = {}; // the C text of the value, folded numbers have none, see Compiler::literals
+} Constant;
+
+typedef struct {
+    CTV_Type type = CTV_NULL;
+    string pointer = {}; // for a constant, the variable holding it if any, for a native value the C value
+    Constant constant = {};
+    NativeType native = NATIVE_NONE;
+    string box = {}; // of a native value, empty when it is always the C value, see NEO_box_int
+} CompileTimeValue;
+
 class VariableDefinition {
 public:
     VariableDefinition() {};
@@ -20,29 +58,22 @@ public:
     string pointer;
     bool constant;
     bool isFunction;
+    string callee; // of a function that is never reassigned, the C function calls to it go to directly
+    // CTV_CONSTANT when a constant was folded, CTV_NATIVE_VARIABLE when the pointer is the box of a C local, there
+    // is no pointer nor local when the variable is never read
+    CompileTimeValue value = {CTV_NULL};
 };
 
-typedef enum {
-    CTV_TEMP,
-    CTV_VARIABLE,
-    CTV_INVALID_VARIABLE,
-    CTV_NULL
-} CTV_Type;
-
-typedef struct {
-    CTV_Type type;
-    string pointer;
-} CompileTimeValue;
-
 class Scope {
 public:
-    Scope(int id, string &fnCode, Scope *parent, bool isLoop) : id(id), fnCode(fnCode), parent(parent), isLoop(isLoop) {};
+    Scope(int id, CodeBuffer &fnCode, Scope *parent, bool isLoop)
+            : id(id), fnCode(fnCode), parent(parent), isLoop(isLoop) {};
 
     int id;
-    string &fnCode;
+    CodeBuffer &fnCode;
     string indentStr = "\t";
     Scope *parent = nullptr;
-    unordered_map<string, VariableDefinition> variables;
+    unordered_map<Atom, VariableDefinition> variables;
     vector<string> temp; // stores the temp variables' names, should be cleared and dereferenced after use
     CompileTimeValue returning;
     bool isLoop;
@@ -51,44 +82,141 @@ public:
 
     void clearTemp();
 
-    VariableDefinition *getVariableDefinition(string name);
+    VariableDefinition *getVariableDefinition(Atom name);
 
     void clearVariables();
 };
 
 typedef struct {
-    Scope *scope;
     Token *errorToken;
-    string functionName;
-    vector<size_t> scopePoint;
+    Atom functionName;
+    uint32_t symbol; // the placeholders of the call, see Compiler::symbols
 } MissingFunctionDefinition;
 
+typedef enum {
+    BUILD_DEFAULT, // no optimization flags
+    BUILD_DEBUG,
+    BUILD_RELEASE
+} BuildProfile;
+
+// How compile builds the binary, from the options of the driver.
+struct BuildOptions {
+    BuildProfile profile = BUILD_DEFAULT;
+    int level = 2; // -O level of release builds
+    bool native = false; // -march=native
+    bool lto = false; // link time optimization across the program and the runtime
+    string training; // when set, the input of a profiled run the binary is rebuilt with
+};
+
 class Compiler {
 public:
-    Compiler(Parser &parser) : parser(parser) {};
+    Compiler(Parser &parser, BuildOptions options = {})
+            : parser(parser), ast(parser.ast), options(options), inference(parser.ast) {};
 
-    unordered_map<string, string> functions;
+    unordered_map<string, CodeBuffer> functions;
+    vector<string> functionList; // the signatures of functions in the order they are written out
     string globalCode;
-    vector<string> functionList;
+    // what the placeholders of the code are replaced with when it is written
+    vector<string> symbols;
+    // the C text of strings made while folding, constants keep views of it
+    deque<string> literals;
+    // the variable of the literal each allocation makes, see literal
+    unordered_map<string, string> literalPool;
     size_t _id = 0;
     Parser &parser;
+    const Ast &ast;
+    BuildOptions options;
+    TypeInference inference;
     vector<MissingFunctionDefinition> missingFunctionDefinitions;
 
+    // The code of the function with signature, added after the others the first time.
+    CodeBuffer &functionCode(const string &signature);
+
+    // Translates the statements into functions, the errors found are reported but not raised.
+    void build();
+
+    // Streams the C translation of what build made.
+    void write(ostream &out) const;
+
+    // build and write to a string.
+    string generate();
+
+    // Builds the binary with gcc, or takes it from the build cache, and runs it.
     void compile();
 
-    void compileScope(Scope *scope, vector<unique_ptr<Statement>> *statements);
+    void compileScope(Scope *scope, NodeList statements);
+
+    CompileTimeValue executeExpression(Scope *scope, NodeId expression);
+
+    // executeExpression, except literals, constants and the pure operations on them are folded into CTV_CONSTANT.
+    CompileTimeValue foldExpression(Scope *scope, NodeId expression);
+
+    // Writes the expression for what it does, its value is not made.
+    void discardExpression(Scope *scope, NodeId expression);
+
+    // Releases a value that is not used, the temp or the box of a native temp.
+    void discardValue(Scope *scope, const CompileTimeValue &value);
+
+    // The pooled object of a CTV_CONSTANT and the boxed native values, other values are already written.
+    CompileTimeValue materialize(Scope *scope, CompileTimeValue value);
+
+    // Writes a op b, folded, in C when the operands are native or number constants, or by the runtime.
+    CompileTimeValue operate(Scope *scope, const string &op, CompileTimeValue a, CompileTimeValue b);
+
+    // Writes a op b in C into result, false when binaryType leaves it to the runtime.
+    bool operateNative(Scope *scope, const string &op, const CompileTimeValue &a, const CompileTimeValue &b,
+                       CompileTimeValue &result);
+
+    // Writes the native temp result of type: the runtime computes it with slow when check, the boxes of the
+    // operands, holds or the C operation fails, otherwise fast does.
+    CompileTimeValue writeNative(Scope *scope, const string &result, NativeType type, string check,
+                                 const string &fails, const string &fast, const string &slow);
+
+    // The argument of NEO_apply for a native value or a constant.
+    string boxedOperand(Scope *scope, const CompileTimeValue &value);
+
+    // Dereferences the box of a native temp.
+    void releaseBox(Scope *scope, const CompileTimeValue &value);
+
+    // Stores value into the native variable, which is declared first when declare is set.
+    void storeNative(Scope *scope, const CompileTimeValue &variable, CompileTimeValue value, bool declare);
+
+    // The variable holding what allocation makes, made once by NEO_initFunctions for the whole program and immortal,
+    // so using it costs nothing. The same allocation is the same variable.
+    string literal(const string &allocation);
+
+    // CTV_INVALID_VARIABLE when the name is not defined, the caller decides what that means
+    CompileTimeValue executeIdentifier(Scope *scope, Token *token);
+
+    CompileTimeValue executeLiteral(Token *token);
+
+    CompileTimeValue executeArray(Scope *scope, NodeId array);
+
+    CompileTimeValue executeObject(Scope *scope, NodeId object);
+
+    CompileTimeValue executeUnary(Scope *scope, NodeId unary);
+
+    CompileTimeValue executeBinary(Scope *scope, NodeId binary);
+
+    CompileTimeValue executeAssignment(Scope *scope, NodeId assignment);
+
+    // The value is what the target was, or is when prefixed, it is not made when not used.
+    CompileTimeValue executeUpdate(Scope *scope, NodeId update, bool used = true);
 
-    CompileTimeValue executeSingleExpression(Scope *scope, vector<Token *> tokens);
+    // Stores into an identifier, a member or an index what compute makes of the value there,
+    // the value is only read for compute when readOriginal is set.
+    CompileTimeValue storeTarget(Scope *scope, NodeId target, bool readOriginal,
+                                 const function<CompileTimeValue(CompileTimeValue)> &compute);
 
-    CompileTimeValue executeExpression(Scope *scope, vector<Token *> tokens);
+    CompileTimeValue combineAssignment(Scope *scope, Token *op, CompileTimeValue original, CompileTimeValue value);
 
-    CompileTimeValue computeBinaryOperation(Scope *scope, vector<Token *> a, Token *op, vector<Token *> b);
+    CompileTimeValue executeMember(Scope *scope, NodeId member);
 
-    CompileTimeValue executeSeparatedExpression(Scope *scope, vector<vector<Token *>> sep);
+    CompileTimeValue executeIndex(Scope *scope, NodeId index);
 
-    CompileTimeValue executeToken(Scope *scope, Token *t0);
+    CompileTimeValue executeCall(Scope *scope, NodeId call);
 
-    void introduceFunction(Scope *scope, string name, vector<unique_ptr<Statement>> *statements, bool isLambda);
+    void introduceFunction(Scope *scope, Atom name, NodeList statements, bool isLambda);
 };
 
 #endif //NEO_COMPILER_HPP
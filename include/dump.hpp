@@ -0,0 +1,80 @@
+#ifndef NEO_DUMP_HPP
+#define NEO_DUMP_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "ast.hpp"
+#include "lexer.hpp"
+
+using namespace std;
+
+// Writes JSON to a stream as it goes, one value per line. Nesting is kept as a depth rather than by indenting
+// what was already written, so a dump is linear in its size. A compact container and everything in it stay on
+// one line. Output is buffered and handed to the stream in large writes, and whenever a top level value is done.
+class JsonWriter {
+public:
+    explicit JsonWriter(ostream &out) : out(out) {};
+
+    ~JsonWriter();
+
+    void flush();
+
+    void beginObject(bool compact = false) { open('{', compact); };
+
+    void endObject() { close('}'); };
+
+    void beginArray(bool compact = false) { open('[', compact); };
+
+    void endArray() { close(']'); };
+
+    // The next value is the one for name.
+    void key(string_view name);
+
+    void value(string_view text);
+
+    void value(const char *text) { value(string_view(text)); };
+
+    void value(bool flag);
+
+    void value(uint64_t number);
+
+    void null();
+
+private:
+    ostream &out;
+    string buffer;
+    size_t depth = 0;
+    size_t compactDepth = SIZE_MAX; // depth of the outermost compact container open
+    bool empty = true; // nothing written in the innermost container yet
+    bool keyed = false; // a key was written, its value goes right after it
+
+    void put(char chr) { buffer += chr; };
+
+    void write(const char *text, size_t size) { buffer.append(text, size); };
+
+    void done();
+
+    void newline();
+
+    void element();
+
+    void open(char bracket, bool compact);
+
+    void close(char bracket);
+
+    void quoted(string_view text);
+};
+
+// {"type": ..., "value": ...}, groups have their "children" instead of a value.
+void writeToken(JsonWriter &json, const Token *token);
+
+void writeTokens(JsonWriter &json, TokenList tokens);
+
+// A node with its children, the keys are the ones of its kind.
+void writeNode(JsonWriter &json, const Ast &ast, NodeId node);
+
+void writeNodes(JsonWriter &json, const Ast &ast, NodeList nodes);
+
+#endif //NEO_DUMP_HPP
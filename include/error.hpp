@@ -2,7 +2,11 @@
 #define NEO_ERROR_HPP
 
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <mutex>
+#include <vector>
+#include "source.hpp"
 
 using namespace std;
 
@@ -12,10 +16,47 @@ using namespace std;
 #define UNDERLINE "\033[4m"
 #define RESET "\033[0m"
 
-void showCodeSnippet(const string &color, const string &filename, const string &code, size_t index);
+void showCodeSnippet(const string &color, const Source *source, size_t index);
 
-void throwError(const string &message, const string &filename, const string &code, size_t index);
+// Reports the error and exits with everything reported so far, or raises ErrorRaised while raiseErrors is set on
+// the thread, for the parser to recover from.
+void throwError(const string &message, const Source *source, size_t index);
 
-void showError(const string &message, const string &filename, const string &code, size_t index);
+class ErrorRaised {};
 
-#endif //NEO_ERROR_HPP
\ No newline at end of file
+extern thread_local bool raiseErrors;
+
+// Prints the error right away.
+void showError(const string &message, const Source *source, size_t index);
+
+// Reports the error and carries on, see Diagnostics.
+void reportError(const string &message, const Source *source, size_t index);
+
+// Collects the errors of a compilation so they are printed together, sorted by file and position, instead of
+// stopping at the first one. The sources must outlive the reports.
+class Diagnostics {
+public:
+    void report(const string &message, const Source *source, size_t index);
+
+    bool hasErrors();
+
+    // Prints and forgets everything reported so far.
+    void flush();
+
+    // Flushes and exits if anything was reported, between the phases that can't work on broken input.
+    void exitOnErrors();
+
+private:
+    typedef struct {
+        string message;
+        const Source *source;
+        size_t index;
+    } Diagnostic;
+
+    mutex lock;
+    vector<Diagnostic> pending;
+};
+
+extern Diagnostics diagnostics;
+
+#endif //NEO_ERROR_HPP
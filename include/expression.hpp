@@ -0,0 +1,57 @@
+#ifndef NEO_EXPRESSION_HPP
+#define NEO_EXPRESSION_HPP
+
+#include <string>
+#include "ast.hpp"
+#include "lexer.hpp"
+
+using namespace std;
+
+// Precedence climbing over a run of tokens, binary operators bind by operatorPrecedence and ** to the right,
+// unary operators bind tighter than any binary one and looser than member access, calls and indexing.
+// Assignments come last and to the right. Syntax errors are thrown from the offending token.
+class ExpressionParser {
+public:
+    ExpressionParser(Ast &ast, TokenList tokens) : ast(ast), tokens(tokens), index(0) {};
+
+    Ast &ast;
+    TokenList tokens;
+    size_t index;
+
+    // The whole run as one expression node, NO_NODE when it is empty.
+    NodeId parse();
+
+private:
+    Token *peek() const;
+
+    NodeId parseAssignment();
+
+    NodeId parseBinary(int minPrecedence);
+
+    NodeId parseUnary();
+
+    NodeId parsePostfix(NodeId expression);
+
+    NodeId parseUpdate(Token *op, NodeId target, bool prefix);
+
+    NodeId parsePrimary();
+
+    NodeId parseArray(Token *group);
+
+    NodeId parseObject(Token *group);
+
+    // [a, b] and {a, b: c}, whose elements and property values are assignment targets.
+    NodeId parsePattern(Token *group);
+
+    NodeId parseTarget(TokenList tokens);
+
+    uint32_t parseArguments(Token *group);
+};
+
+NodeId parseExpression(Ast &ast, TokenList tokens);
+
+int operatorPrecedence(string_view op);
+
+bool isAssignmentOperator(const Token *token);
+
+#endif //NEO_EXPRESSION_HPP
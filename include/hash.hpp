@@ -0,0 +1,41 @@
+#ifndef NEO_HASH_HPP
+#define NEO_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Fast non-cryptographic 64 bit hash for content addressed caches, eight bytes per step.
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
+
+inline uint64_t hashBytes(string_view data, uint64_t seed = 0) {
+    return hashBytes(data.data(), data.size(), seed);
+}
+
+// The hash as 16 hex digits, for file names.
+string hashToString(uint64_t hash);
+
+// Passes what is written on to target and hashes it on the way, a block at a time.
+class HashingBuffer : public streambuf {
+public:
+    explicit HashingBuffer(streambuf *target) : target(target) { setp(block, block + sizeof(block)); };
+
+    // Of everything written so far, flushes it.
+    uint64_t hash();
+
+protected:
+    int overflow(int chr) override;
+
+    int sync() override;
+
+private:
+    streambuf *target;
+    uint64_t state = 0;
+    char block[64 * 1024];
+};
+
+#endif //NEO_HASH_HPP
@@ -0,0 +1,39 @@
+#ifndef NEO_INCREMENTAL_HPP
+#define NEO_INCREMENTAL_HPP
+
+#include "lexer.hpp"
+#include "parser.hpp"
+
+using namespace std;
+
+// A parsed source kept between edits, for watch and editor mode. An edit inside a {} group re-lexes only that group
+// and re-parses only the innermost block around it, the tokens and statements of the rest of the file are reused.
+// Reused tokens keep pointing at the source they were lexed from, see Source::forward, so the older sources are kept
+// until they add up to a few times the current one. The document owns everything in the arena, a full build resets it.
+class Document {
+public:
+    Document(shared_ptr<Source> source, Arena *arena);
+
+    Parser parser;
+
+    // Re-analyzes after the source changed, returns false if everything had to be lexed and parsed again.
+    bool update(shared_ptr<Source> source);
+
+    // Same, with the edit known: code[start, oldEnd) of the current source is code[start, newEnd) of the new one.
+    bool update(shared_ptr<Source> source, size_t start, size_t oldEnd, size_t newEnd);
+
+private:
+    Arena *arena;
+    size_t builtSize = 0; // arena usage right after the last full build
+    size_t builtNodes = 0; // and the size of the tree
+    vector<shared_ptr<Source>> history; // sources edited since then that tokens may still point at
+    size_t historySize = 0;
+
+    void build(shared_ptr<Source> source);
+
+    Token *findGroup(size_t start, size_t end) const;
+
+    void rebase(TokenList tokens);
+};
+
+#endif //NEO_INCREMENTAL_HPP
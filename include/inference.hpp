@@ -0,0 +1,98 @@
+#ifndef NEO_INFERENCE_HPP
+#define NEO_INFERENCE_HPP
+
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ast.hpp"
+#include "atom.hpp"
+#include "lexer.hpp"
+
+using namespace std;
+
+// How a value is held in the generated C.
+typedef enum {
+    NATIVE_NONE, // a NeoObject
+    NATIVE_INT, // an int64_t
+    NATIVE_DOUBLE,
+    NATIVE_BOOL, // an int, what comparing native values makes
+    NATIVE_UNKNOWN // not inferred yet
+} NativeType;
+
+// Where the generated C keeps a variable that is a NeoObject.
+typedef enum {
+    STORAGE_GLOBAL, // the program's own variables and the ones nested functions name, which read them from there
+    STORAGE_LOCAL // a local of the C function the variable is declared in
+} Storage;
+
+// The type of a number literal the compiler folds, NATIVE_NONE for the others.
+NativeType literalType(const Token *token);
+
+// The type of a op b when the compiler writes it in C, NATIVE_NONE when it is left to the runtime.
+NativeType binaryType(string_view op, NativeType a, NativeType b);
+
+// Finds the variables that only ever hold ints, or only doubles, so the compiler keeps them in C locals. The
+// program and each function are inferred on their own, a variable a nested function names stays a NeoObject as
+// the function reads it from its global. Every variable is taken to have the type of the values stored in it so
+// far, until nothing changes. The variables no nested function names are also the ones that can be C locals.
+class TypeInference {
+public:
+    explicit TypeInference(const Ast &ast) : ast(ast) {};
+
+    // Infers the program and every function in it.
+    void infer(NodeList statements);
+
+    // NATIVE_INT or NATIVE_DOUBLE for a declaration of such a variable, NATIVE_NONE for the others.
+    NativeType type(NodeId declaration) const;
+
+    // STORAGE_LOCAL for a declaration of a variable only the function or the block it is in names.
+    Storage storage(NodeId declaration) const;
+
+    // Whether a declared variable is ever read, the values stored in one that is not only have to be computed.
+    bool read(NodeId declaration) const;
+
+    // Whether the name is assigned to anywhere, a function declared under it may not be the one it holds then.
+    bool reassigned(Atom name) const;
+
+private:
+    struct Variable {
+        NodeId declaration;
+        Atom name;
+        NativeType type;
+        bool topLevel; // declared by the program outside of any block
+        bool read; // named other than as the target of =
+        vector<NodeId> definitions; // the declaration and the assignments and updates of the variable
+    };
+
+    const Ast &ast;
+    vector<NativeType> types; // by node, of the declarations
+    vector<Storage> storages; // by node, of the declarations
+    vector<bool> reads; // by node, of the declarations
+    vector<int> resolved; // by node, the variable an identifier names or -1
+    vector<NodeList> pending; // bodies of functions left to infer
+    vector<Variable> variables;
+    unordered_set<Atom> assigned; // the names assigned to in the whole program
+
+    // of the body being inferred
+    vector<unordered_map<Atom, int>> scopes; // a variable index, -1 for the names that aren't candidates
+    unordered_set<Atom> captured; // names used in nested functions
+
+    void inferBody(NodeList statements, bool program);
+
+    void walkStatements(NodeList statements);
+
+    void walkExpression(NodeId expression);
+
+    void walkTarget(NodeId definition, NodeId target);
+
+    int resolve(Atom name) const;
+
+    void capture(NodeId node);
+
+    NativeType expressionType(NodeId expression) const;
+
+    NativeType definitionType(const Variable &variable, NodeId definition) const;
+};
+
+#endif //NEO_INFERENCE_HPP
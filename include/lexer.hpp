@@ -4,9 +4,14 @@
 #ifdef __cplusplus
 
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
+#include <memory>
 #include <cstdint>
+#include "arena.hpp"
+#include "atom.hpp"
+#include "source.hpp"
 
 using namespace std;
 
@@ -31,59 +36,88 @@ typedef enum {
 
 #define IsAnyOperatorToken(t) (t->type == T_OPERATOR || t->type == T_INC_OPERATOR || t->type == T_SET_OPERATOR)
 
+class Token;
+
+// A view of contiguous token pointers, group children live in the arena like this.
+class TokenList {
+public:
+    TokenList() : items(nullptr), count(0) {};
+
+    TokenList(Token **items, size_t count) : items(items), count(count) {};
+
+    TokenList(const vector<Token *> &tokens) : items((Token **) tokens.data()), count(tokens.size()) {};
+
+    Token **items;
+    size_t count;
+
+    size_t size() const { return count; };
+
+    bool empty() const { return count == 0; };
+
+    Token *operator[](size_t i) const { return items[i]; };
+
+    Token **begin() const { return items; };
+
+    Token **end() const { return items + count; };
+
+    Token *back() const { return items[count - 1]; };
+
+    vector<Token *> toVector() const { return vector<Token *>(begin(), end()); };
+};
+
 class Token {
 public:
-    Token(TokenType type, string filename, string code, size_t start, size_t end, string value)
-            : type(type), filename(filename), code(std::move(code)), start(start), end(end), value(std::move(value)),
-              parent(nullptr) {};
+    Token(TokenType type, const Source *source, size_t start, size_t end, string_view value)
+            : type(type), atom(A_NONE), source(source), start(start), end(end), value(value), parent(nullptr) {};
 
-    Token(TokenType type, string filename, const string &code, size_t start, size_t end)
-            : Token(type, filename, code, start, end, code.substr(start, end - start)) {};
+    Token(TokenType type, const Source *source, size_t start, size_t end)
+            : Token(type, source, start, end, source->code.substr(start, end - start)) {};
 
     TokenType type;
-    string filename;
-    string code;
+    Atom atom; // identifiers and keywords only
+    const Source *source;
     size_t start;
     size_t end;
-    string value;
+    string_view value; // points into source->code
     Token *parent;
-    vector<Token *> children;
+    TokenList children;
 
     void updateValue();
 
-    string toString();
+    // The token as JSON, see writeToken.
+    string toString() const;
 
     void throwError(const string &message) const;
 
-    __attribute__((unused)) void dump();
+    void reportError(const string &message) const;
 
-    void free(bool freeChildren = true);
+    __attribute__((unused)) void dump() const;
 
     void showError(const string &message) const;
 };
 
-vector<vector<Token *>> splitTokens(vector<Token *> tokens, string delim, bool emptyError = false);
+vector<vector<Token *>> splitTokens(TokenList tokens, string delim, bool emptyError = false);
+
+string stringLiteral(string_view value);
 
-string tokensToString(const string &pre, vector<Token *> tokens);
+char closingParen(char open);
 
-string tokensListToString(const string &pre, vector<vector<Token *>> tokens);
+const string &tokenTypeName(TokenType type);
 
 class Lexer {
 public:
-    explicit Lexer(string code, string filename)
-            : code(std::move(code)), filename(filename),
-              eof(new Token(T_EOF, filename, code, code.size(), code.size(), "")), index(-1) {
+    Lexer(shared_ptr<Source> source, Arena *arena)
+            : source(std::move(source)), arena(arena), index(-1) {
+        code = this->source->code;
+        eof = arena->make<Token>(T_EOF, this->source.get(), code.size(), code.size(), "");
     };
 
-    Lexer(string code, string filename, vector<Token *> tokens)
-            : Lexer(code, filename) {
-        this->tokens = tokens;
-    };
+    shared_ptr<Source> source;
+    Arena *arena; // owns every token and group, see freeTokens
+    vector<Token *> stream; // ungrouped tokens, filled by tokenize and consumed by groupTokens
+    TokenList tokens;
 
-    string filename;
-    vector<Token *> tokens;
-
-    string code;
+    string_view code;
     size_t index;
     Token *eof;
 
@@ -95,14 +129,25 @@ public:
 
     void tokenize();
 
+    // Lexes code[from, to) into the stream, returns where it stopped: to, or later if the last token runs past it.
+    size_t tokenizeRange(size_t from, size_t to);
+
     void groupTokens();
 
+    // Groups a balanced run of tokens, the outermost groups get parent as their parent.
+    TokenList groupStream(Token *const *items, size_t count, Token *parent);
+
+    // {"tokens": [...]} as JSON.
     string toString() const;
 
     __attribute__((unused)) void dump() const;
 
     void throwError(const string &message, size_t index) const;
 
+    void reportError(const string &message, size_t index) const;
+
+    TokenList copyTokens(Token *const *items, size_t count);
+
     void freeTokens();
 
     void showError(const string &message, size_t index_) const;
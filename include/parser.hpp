@@ -8,214 +8,34 @@
 #include <vector>
 #include <cstdint>
 #include <iostream>
-#include <memory>
+#include <unordered_map>
+#include "ast.hpp"
+#include "expression.hpp"
 #include "lexer.hpp"
 
 using namespace std;
 
-typedef enum {
-    S_VARIABLE_DECLARATION,
-    S_FUNCTION_DECLARATION,
-    S_DO,
-    S_LOOP,
-    S_WHILE,
-    S_DO_WHILE,
-    S_FOR_ITERATOR,
-    S_FOR_CLASSIC,
-    S_RETURN,
-    S_BREAK,
-    S_CONTINUE,
-    S_CLASS_DEFINITION,
-    S_IF_FLOW,
-    S_IMPORT,
-    S_EXPRESSION
-} StatementType;
-
-class Statement {
-public:
-    Statement(StatementType type) : type(type) {};
-
-    StatementType type;
-
-    virtual string toString();
-
-    __attribute__((unused)) void dump() { cout << toString() << endl; };
-};
-
-class VariableDeclarationStatement : public Statement {
-public:
-    VariableDeclarationStatement(Token *name, vector<Token *> value, bool constant)
-            : name(std::move(name)), value(std::move(value)), constant(constant), Statement(S_VARIABLE_DECLARATION) {};
-    Token *name;
-    vector<Token *> value;
-    bool constant;
-
-    string toString() override;
-};
-
-class FunctionDeclarationStatement : public Statement {
-public:
-    FunctionDeclarationStatement(Token *name, vector<vector<Token *>> arguments, vector<unique_ptr<Statement>> body)
-            : name(name), arguments(arguments), body(std::move(body)), Statement(S_FUNCTION_DECLARATION) {};
-
-    Token *name;
-    vector<vector<Token *>> arguments;
-    vector<unique_ptr<Statement>> body;
-
-    string toString() override;
-};
-
-class DoStatement : public Statement {
-public:
-    explicit DoStatement(vector<unique_ptr<Statement>> body)
-            : body(std::move(body)), Statement(S_DO) {};
-
-    vector<unique_ptr<Statement>> body;
-
-    string toString() override;
-};
-
-class LoopStatement : public Statement {
-public:
-    explicit LoopStatement(vector<unique_ptr<Statement>> body)
-            : body(std::move(body)), Statement(S_LOOP) {};
-
-    vector<unique_ptr<Statement>> body;
-
-    string toString() override;
-};
-
-class WhileStatement : public Statement {
-public:
-    explicit WhileStatement(vector<Token *> condition, vector<unique_ptr<Statement>> body)
-            : condition(condition), body(std::move(body)), Statement(S_WHILE) {};
-
-    vector<Token *> condition;
-    vector<unique_ptr<Statement>> body;
-
-    string toString() override;
-};
-
-class DoWhileStatement : public Statement {
-public:
-    explicit DoWhileStatement(vector<Token *> condition, vector<unique_ptr<Statement>> body)
-            : condition(condition), body(std::move(body)), Statement(S_DO_WHILE) {};
-
-    vector<Token *> condition;
-    vector<unique_ptr<Statement>> body;
-
-    string toString() override;
-};
-
-class ForIteratorStatement : public Statement {
-public:
-    explicit ForIteratorStatement(Token *index, Token *value, vector<Token *> iterator,
-                                  vector<unique_ptr<Statement>> body)
-            : index(index), value(value), iterator(iterator), body(std::move(body)), Statement(S_FOR_ITERATOR) {};
-
-    Token *index;
-    Token *value;
-    vector<Token *> iterator;
-    vector<unique_ptr<Statement>> body;
-
-    string toString() override;
-};
-
-class ForClassicStatement : public Statement {
-public:
-    explicit ForClassicStatement(unique_ptr<Statement> init, vector<Token *> condition, unique_ptr<Statement> iterator,
-                                 vector<unique_ptr<Statement>> body)
-            : init(std::move(init)), condition(condition), iterator(std::move(iterator)), body(std::move(body)),
-              Statement(S_FOR_CLASSIC) {};
-
-    unique_ptr<Statement> init;
-    vector<Token *> condition;
-    unique_ptr<Statement> iterator;
-    vector<unique_ptr<Statement>> body;
-
-    string toString() override;
-};
-
-class ReturnStatement : public Statement {
-public:
-    ReturnStatement(vector<Token *> value) : value(value), Statement(S_RETURN) {};
-
-    vector<Token *> value;
-
-    string toString() override;
-};
-
-class BreakStatement : public Statement {
-public:
-    BreakStatement() : Statement(S_BREAK) {};
-
-    string toString() override;
-};
-
-class ContinueStatement : public Statement {
-public:
-    ContinueStatement() : Statement(S_CONTINUE) {};
-
-    string toString() override;
-};
-
-class ClassDefinitionStatement : public Statement {
-public:
-    explicit ClassDefinitionStatement(vector<unique_ptr<Statement>> attributes,
-                                      vector<unique_ptr<Statement>> methods)
-            : attributes(std::move(attributes)), methods(std::move(methods)),
-              Statement(S_CLASS_DEFINITION) {};
-
-    vector<unique_ptr<Statement>> attributes;
-    vector<unique_ptr<Statement>> methods;
-
-    string toString() override;
-};
-
-class IfFlowStatement : public Statement {
-public:
-    explicit IfFlowStatement(vector<Token *> condition, vector<unique_ptr<Statement>> body,
-                             vector<unique_ptr<Statement>> elseBody)
-            : condition(std::move(condition)), body(std::move(body)), elseBody(std::move(elseBody)),
-              Statement(S_IF_FLOW) {};
-
-    vector<Token *> condition;
-    vector<unique_ptr<Statement>> body;
-    vector<unique_ptr<Statement>> elseBody;
-
-    string toString() override;
-};
-
-class ImportStatement : public Statement {
-public:
-    explicit ImportStatement(Token *name, vector<Token *> imports)
-            : name(name), imports(std::move(imports)), Statement(S_IMPORT) {};
-
-    Token *name;
-    vector<Token *> imports;
-
-    string toString() override;
-};
-
-class ExpressionStatement : public Statement {
-public:
-    explicit ExpressionStatement(vector<Token *> expression)
-            : expression(std::move(expression)), Statement(S_EXPRESSION) {};
-
-    vector<Token *> expression;
-
-    string toString() override;
-};
-
 class Parser {
 public:
     explicit Parser(Lexer lexer) : lexer(std::move(lexer)), index(-1) {};
 
-    vector<unique_ptr<Statement>> statements;
-    vector<Token *> accumulator;
+    Ast ast;
+    uint32_t root = NO_NODE; // slot of the top level statements
+    // the slot of the statements parsed from each {} group, nested ones included, so a block can be parsed again
+    unordered_map<Token *, uint32_t> blocks;
 
     Lexer lexer;
+    // the block being parsed and where its statements start on ast.scratch, nested blocks swap them in and out
+    TokenList tokens;
     size_t index;
+    size_t output = 0;
+    // threads parsing the bodies of the top level functions, 0 for one per core
+    unsigned threads = 0;
+    // top level function bodies left for parseDeferred, with the slot they go to
+    vector<pair<Token *, uint32_t>> deferred;
+    bool deferring = false;
+
+    NodeList statements() const { return root == NO_NODE ? NodeList() : ast.list(root); };
 
     Token *peek(size_t offset = 0) const;
 
@@ -223,7 +43,13 @@ public:
 
     Token *next(size_t offset = 1);
 
-    Token *accumulate(size_t offset = 1);
+    // Parses block into the list at slot with the same parser, group is recorded in blocks when it is a {} group.
+    void parseBlock(Token *group, TokenList block, uint32_t slot);
+
+    // Drops the blocks recorded for the groups in block, before their statements are replaced.
+    void forgetBlocks(TokenList block);
+
+    TokenList restOfLine();
 
     void parseVariableDeclarationStatement();
 
@@ -247,6 +73,19 @@ public:
 
     void parse();
 
+    // Parses the deferred function bodies on their own parsers, a contiguous run of them per thread, and moves
+    // the trees into ast in source order.
+    void parseDeferred();
+
+    // Syntax errors are reported and the statement they are in is left out, see skipStatement.
+    void parseStatements();
+
+    void parseStatement(Token *token);
+
+    // Moves to the end of the line the current statement is on.
+    void skipStatement();
+
+    // The statements as a JSON array, see writeNode.
     string toString();
 
     __attribute__((unused)) void dump();
@@ -254,8 +93,6 @@ public:
     void parseReturnStatement();
 };
 
-vector<vector<Token *>> separateExpression(vector<Token *> tokens);
-
 #endif
 
 #endif //NEOLANG_PARSER_H
@@ -0,0 +1,66 @@
+#ifndef NEO_SOURCE_HPP
+#define NEO_SOURCE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// Size of the windows large inputs are read and lexed in.
+#define SOURCE_CHUNK_SIZE (4 * 1024 * 1024)
+
+// A source file, shared by every lexer, parser and token that refers to it.
+// The code is either owned or a read only mapping of the file, tokens are views into it either way.
+class Source {
+public:
+    Source(string filename, string code);
+
+    Source(const Source &) = delete;
+
+    Source &operator=(const Source &) = delete;
+
+    ~Source();
+
+    // Maps the file, or reads it if mapped is false, "-" reads the standard input chunk by chunk.
+    // Returns nullptr if it can't be read.
+    static shared_ptr<Source> load(const string &filename, bool mapped = true);
+
+    // Hints that [offset, offset + length) is about to be read, so the pages can be read in ahead of the lexer.
+    void prefetch(size_t offset, size_t length) const;
+
+    // Follows the edits made since offset was taken in this source, returns the newest source and moves offset along.
+    const Source *forward(size_t &offset) const;
+
+    // Line and column of an offset, both counted from 1. O(log n), the line starts are indexed on first use.
+    void location(size_t offset, size_t &line, size_t &column) const;
+
+    // A line without its newline, counted from 1.
+    string_view line(size_t number) const;
+
+    string filename;
+    string_view code;
+
+    // Set once an incremental update edited this source into a newer one, tokens it kept still point here:
+    // everything from editEnd on moved by editDelta.
+    const Source *edited = nullptr;
+    size_t editEnd = 0;
+    ptrdiff_t editDelta = 0;
+
+private:
+    Source(string filename) : filename(std::move(filename)) {};
+
+    string storage;
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+
+    mutable vector<size_t> lineStarts;
+    mutable once_flag lineIndexed;
+
+    const vector<size_t> &lineIndex() const;
+};
+
+#endif //NEO_SOURCE_HPP
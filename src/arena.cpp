@@ -0,0 +1,42 @@
+#include "arena.hpp"
+#include <cstdint>
+#include <cstdlib>
+
+Arena::~Arena() {
+    reset();
+}
+
+void *Arena::allocate(size_t size, size_t align) {
+    auto aligned = (char *) (((uintptr_t) cursor + align - 1) & ~(uintptr_t) (align - 1));
+    if (cursor == nullptr || aligned + size > limit) {
+        if (cursor != nullptr) {
+            usedBefore += cursor - blocks.back();
+        }
+        // oversized requests get a block of their own
+        auto size_ = size + align > blockSize ? size + align : blockSize;
+        auto block = (char *) malloc(size_);
+        if (block == nullptr) {
+            throw bad_alloc();
+        }
+        blocks.push_back(block);
+        cursor = block;
+        limit = block + size_;
+        aligned = (char *) (((uintptr_t) cursor + align - 1) & ~(uintptr_t) (align - 1));
+    }
+    cursor = aligned + size;
+    return aligned;
+}
+
+void Arena::reset() {
+    for (auto block: blocks) {
+        free(block);
+    }
+    blocks.clear();
+    cursor = nullptr;
+    limit = nullptr;
+    usedBefore = 0;
+}
+
+size_t Arena::used() const {
+    return blocks.empty() ? 0 : usedBefore + (cursor - blocks.back());
+}
@@ -0,0 +1,147 @@
+#include "ast.hpp"
+
+using namespace std;
+
+void Ast::clear() {
+    kinds.clear();
+    flags.clear();
+    tokens.clear();
+    lhs.clear();
+    rhs.clear();
+    extra.clear();
+    tokenLists.clear();
+    scratch.clear();
+}
+
+NodeId Ast::add(NodeKind kind, Token *token, uint32_t left, uint32_t right, uint8_t flag) {
+    kinds.push_back(kind);
+    flags.push_back(flag);
+    tokens.push_back(token);
+    lhs.push_back(left);
+    rhs.push_back(right);
+    return kinds.size() - 1;
+}
+
+uint32_t Ast::reserve(size_t words) {
+    auto start = extra.size();
+    extra.resize(start + words, 0);
+    return start;
+}
+
+void Ast::endList(size_t mark, uint32_t slot) {
+    auto start = extra.size();
+    extra.insert(extra.end(), scratch.begin() + mark, scratch.end());
+    extra[slot] = start;
+    extra[slot + 1] = scratch.size() - mark;
+    scratch.resize(mark);
+}
+
+uint32_t Ast::addTokens(TokenList list) {
+    auto start = tokenLists.size();
+    tokenLists.insert(tokenLists.end(), list.begin(), list.end());
+    return start;
+}
+
+static void relocateSlot(vector<uint32_t> &extra, uint32_t slot, uint32_t nodeBase, uint32_t extraBase) {
+    // the slot and its ids have been copied already, they still point into the part
+    auto start = extra[slot] += extraBase;
+    for (uint32_t i = 0; i < extra[slot + 1]; i++) {
+        if (extra[start + i] != NO_NODE) {
+            extra[start + i] += nodeBase;
+        }
+    }
+}
+
+uint32_t Ast::append(const Ast &part, const vector<uint32_t> &slots) {
+    uint32_t nodes = size(), words = extra.size(), runs = tokenLists.size();
+    kinds.insert(kinds.end(), part.kinds.begin(), part.kinds.end());
+    flags.insert(flags.end(), part.flags.begin(), part.flags.end());
+    tokens.insert(tokens.end(), part.tokens.begin(), part.tokens.end());
+    extra.insert(extra.end(), part.extra.begin(), part.extra.end());
+    tokenLists.insert(tokenLists.end(), part.tokenLists.begin(), part.tokenLists.end());
+    lhs.reserve(size());
+    rhs.reserve(size());
+
+    auto node = [&](uint32_t id) { return id == NO_NODE ? id : id + nodes; };
+    for (NodeId i = 0; i < part.size(); i++) {
+        auto left = part.lhs[i];
+        auto right = part.rhs[i];
+        switch (part.kinds[i]) {
+            case S_VARIABLE_DECLARATION:
+            case S_RETURN:
+            case S_EXPRESSION:
+            case E_UNARY:
+            case E_UPDATE:
+            case E_MEMBER:
+            case E_KEYWORD_ARGUMENT:
+                left = node(left);
+                break;
+            case E_PROPERTY:
+            case E_BINARY:
+            case E_ASSIGNMENT:
+            case E_INDEX:
+                left = node(left);
+                right = node(right);
+                break;
+            case S_FUNCTION_DECLARATION:
+                left += words;
+                for (uint32_t j = 0; j < extra[left]; j++) {
+                    extra[left + 1 + 2 * j] += runs;
+                }
+                right += words;
+                relocateSlot(extra, right, nodes, words);
+                break;
+            case S_DO:
+            case S_LOOP:
+            case E_ARRAY:
+            case E_OBJECT:
+                left += words;
+                relocateSlot(extra, left, nodes, words);
+                break;
+            case S_CLASS_DEFINITION:
+                left += words;
+                right += words;
+                relocateSlot(extra, left, nodes, words);
+                relocateSlot(extra, right, nodes, words);
+                break;
+            case S_WHILE:
+            case S_DO_WHILE:
+            case E_CALL:
+                left = node(left);
+                right += words;
+                relocateSlot(extra, right, nodes, words);
+                break;
+            case S_IF_FLOW:
+                left = node(left);
+                right += words;
+                relocateSlot(extra, right, nodes, words);
+                relocateSlot(extra, right + 2, nodes, words);
+                break;
+            case S_FOR_ITERATOR:
+                left = node(left);
+                right += words;
+                relocateSlot(extra, right, nodes, words);
+                extra[right + 2] += runs;
+                break;
+            case S_FOR_CLASSIC:
+                left = node(left);
+                right += words;
+                relocateSlot(extra, right, nodes, words);
+                extra[right + 2] = node(extra[right + 2]);
+                extra[right + 3] = node(extra[right + 3]);
+                break;
+            case S_IMPORT:
+                left += words;
+                extra[left] += runs;
+                break;
+            default:
+                break;
+        }
+        lhs.push_back(left);
+        rhs.push_back(right);
+    }
+    for (auto slot: slots) {
+        relocateSlot(extra, slot + words, nodes, words);
+    }
+    return words;
+}
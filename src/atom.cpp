@@ -0,0 +1,56 @@
+#include "atom.hpp"
+#include <cstring>
+
+AtomTable atomTable;
+
+static uint32_t hashName(string_view name) {
+    // FNV-1a, identifiers are short
+    uint32_t hash = 2166136261u;
+    for (auto chr: name) {
+        hash = (hash ^ (uint8_t) chr) * 16777619u;
+    }
+    return hash;
+}
+
+AtomTable::AtomTable() : slots(1024, A_NONE), storage(16 * 1024) {
+    names.push_back("");
+    hashes.push_back(0);
+    for (size_t i = 1; i < A_PREDEFINED_COUNT; i++) {
+        intern(predefinedAtomNames[i]);
+    }
+}
+
+Atom AtomTable::intern(string_view name) {
+    auto hash = hashName(name);
+    auto mask = slots.size() - 1;
+    auto i = hash & mask;
+    for (; slots[i] != A_NONE; i = (i + 1) & mask) {
+        auto atom = slots[i];
+        if (hashes[atom] == hash && names[atom] == name) {
+            return atom;
+        }
+    }
+
+    auto data = (char *) storage.allocate(name.size(), 1);
+    memcpy(data, name.data(), name.size());
+    Atom atom = names.size();
+    names.emplace_back(data, name.size());
+    hashes.push_back(hash);
+    slots[i] = atom;
+    if (names.size() * 2 > slots.size()) {
+        grow();
+    }
+    return atom;
+}
+
+void AtomTable::grow() {
+    slots.assign(slots.size() * 2, A_NONE);
+    auto mask = slots.size() - 1;
+    for (Atom atom = 1; atom < names.size(); atom++) {
+        auto i = hashes[atom] & mask;
+        while (slots[i] != A_NONE) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = atom;
+    }
+}
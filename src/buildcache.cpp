@@ -0,0 +1,57 @@
+#include "buildcache.hpp"
+#include "hash.hpp"
+#include "source.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+string BuildCache::entryPath(uint64_t key) const {
+    return directory + "/" + hashToString(key);
+}
+
+uint64_t BuildCache::key(uint64_t codeHash, const string &command, const vector<string> &runtime) {
+    // the runtime is hashed by content, in path order so the directory listing order doesn't matter
+    error_code error;
+    vector<string> paths;
+    for (auto &root: runtime) {
+        if (filesystem::is_regular_file(root, error)) {
+            paths.push_back(root);
+            continue;
+        }
+        for (auto &entry: filesystem::recursive_directory_iterator(root, error)) {
+            auto extension = entry.path().extension();
+            if (entry.is_regular_file(error) && (extension == ".c" || extension == ".h")) {
+                paths.push_back(entry.path().generic_string());
+            }
+        }
+    }
+    sort(paths.begin(), paths.end());
+    auto hash = hashBytes(command, codeHash);
+    for (auto &path: paths) {
+        hash = hashBytes(path, hash);
+        auto source = Source::load(path);
+        if (source != nullptr) {
+            hash = hashBytes(source->code, hash);
+        }
+    }
+    return hash;
+}
+
+bool BuildCache::load(uint64_t key, const string &binary) const {
+    error_code error;
+    filesystem::copy_file(entryPath(key), binary, filesystem::copy_options::overwrite_existing, error);
+    return !error;
+}
+
+void BuildCache::save(uint64_t key, const string &binary) const {
+    // copied next to the entry and renamed over it, so a concurrent run never copies half of it
+    error_code error;
+    filesystem::create_directories(directory, error);
+    auto path = entryPath(key);
+    auto temporary = path + ".tmp";
+    if (!filesystem::copy_file(binary, temporary, filesystem::copy_options::overwrite_existing, error)) {
+        filesystem::remove(temporary, error);
+        return;
+    }
+    filesystem::rename(temporary, path, error);
+}
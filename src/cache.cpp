@@ -0,0 +1,400 @@
+#include "cache.hpp"
+#include "hash.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#define NO_INDEX 0xFFFFFFFFu
+
+// An entry is a CacheHeader followed by
+//   CachedToken tokens[tokenCount], in tree order
+//   uint32_t children[childCount], the child lists of the groups and then the top level list, next to each other
+//   uint32_t names[nameCount], a token spelling each distinct identifier or keyword
+//   uint32_t nodeTokens[nodeCount], lhs[nodeCount], rhs[nodeCount], the columns of the Ast with tokens as indexes
+//   uint32_t extra[extraCount]
+//   uint32_t tokenLists[tokenListCount], as indexes
+//   uint32_t blocks[blockCount * 2], a group and the slot of its statements
+//   uint8_t kinds[nodeCount], flags[nodeCount]
+// all in the byte order of the machine that wrote it, sizes and offsets are 32 bit.
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t hash;
+    uint64_t size;
+    uint64_t checksum; // of everything after the header, a damaged entry is parsed again rather than trusted
+    uint32_t tokenCount;
+    uint32_t childCount;
+    uint32_t nameCount;
+    uint32_t topLevel; // where the top level list starts in children
+    uint32_t topLevelCount;
+    uint32_t nodeCount;
+    uint32_t extraCount;
+    uint32_t tokenListCount;
+    uint32_t blockCount;
+    uint32_t root;
+} CacheHeader;
+
+typedef struct {
+    uint32_t type;
+    uint32_t start;
+    uint32_t end;
+    uint32_t name; // index into names, NO_INDEX if the token has no atom
+    uint32_t parent; // NO_INDEX at the top level
+    uint32_t children; // index into children
+    uint32_t childCount;
+} CachedToken;
+
+static const char cacheMagic[4] = {'N', 'E', 'O', 'C'};
+
+string ParseCache::entryPath(const Source *source) const {
+    auto hash = hashBytes(source->code, PARSE_CACHE_VERSION);
+    return directory + "/" + hashToString(hash) + ".neoc";
+}
+
+static bool validTree(const Ast &ast, uint32_t root) {
+    // the entry passed its checksum, this only keeps a stale layout from sending the compiler out of bounds
+    auto nodes = ast.size();
+    auto words = ast.extra.size();
+    auto node = [&](uint32_t id) { return id == NO_NODE || id < nodes; };
+    auto required = [&](uint32_t id) { return id < nodes; };
+    auto slot = [&](uint32_t at) {
+        if (at >= words || words - at < 2 || ast.extra[at] > words || ast.extra[at + 1] > words - ast.extra[at]) {
+            return false;
+        }
+        for (auto id: ast.list(at)) {
+            if (id >= nodes) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto run = [&](uint32_t at) {
+        return at < words && words - at >= 2 && ast.extra[at] <= ast.tokenLists.size() &&
+               ast.extra[at + 1] <= ast.tokenLists.size() - ast.extra[at];
+    };
+    if (!slot(root)) {
+        return false;
+    }
+    for (NodeId i = 0; i < nodes; i++) {
+        auto left = ast.lhs[i];
+        auto right = ast.rhs[i];
+        auto named = ast.tokens[i] != nullptr;
+        bool ok;
+        switch (ast.kinds[i]) {
+            case S_VARIABLE_DECLARATION:
+                ok = named && node(left);
+                break;
+            case S_FUNCTION_DECLARATION:
+                ok = named && left < words && (words - left - 1) / 2 >= ast.extra[left] && slot(right);
+                for (uint32_t p = 0; ok && p < ast.extra[left]; p++) {
+                    ok = run(left + 1 + 2 * p);
+                }
+                break;
+            case S_DO:
+            case S_LOOP:
+                ok = slot(left);
+                break;
+            case S_WHILE:
+            case S_DO_WHILE:
+                ok = node(left) && slot(right);
+                break;
+            case S_FOR_ITERATOR:
+                ok = named && node(left) && slot(right) && right + 2 < words &&
+                     ast.extra[right + 2] < ast.tokenLists.size();
+                break;
+            case S_FOR_CLASSIC:
+                ok = node(left) && slot(right) && right + 3 < words && required(ast.extra[right + 2]) &&
+                     required(ast.extra[right + 3]);
+                break;
+            case S_RETURN:
+            case S_EXPRESSION:
+                ok = node(left);
+                break;
+            case S_BREAK:
+            case S_CONTINUE:
+                ok = true;
+                break;
+            case S_CLASS_DEFINITION:
+                ok = slot(left) && slot(right);
+                break;
+            case S_IF_FLOW:
+                ok = node(left) && slot(right) && slot(right + 2);
+                break;
+            case S_IMPORT:
+                ok = named && run(left);
+                break;
+            case E_LITERAL:
+            case E_IDENTIFIER:
+                ok = named;
+                break;
+            case E_ARRAY:
+            case E_OBJECT:
+                ok = named && slot(left);
+                break;
+            case E_PROPERTY:
+                ok = named && node(left) && required(right);
+                break;
+            case E_UNARY:
+            case E_UPDATE:
+            case E_MEMBER:
+            case E_KEYWORD_ARGUMENT:
+                ok = named && required(left);
+                break;
+            case E_BINARY:
+            case E_ASSIGNMENT:
+            case E_INDEX:
+                ok = named && required(left) && required(right);
+                break;
+            case E_CALL:
+                ok = named && required(left) && slot(right);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void numberTokens(TokenList tokens, unordered_map<const Token *, uint32_t> &ids, vector<Token *> &order) {
+    // preorder, a group comes right before its children
+    for (auto token: tokens) {
+        ids[token] = order.size();
+        order.push_back(token);
+        if (token->type == T_GROUP) {
+            numberTokens(token->children, ids, order);
+        }
+    }
+}
+
+void ParseCache::save(Parser &parser) const {
+    auto source = parser.lexer.source.get();
+    if (source->code.size() >= NO_INDEX) {
+        return;
+    }
+
+    unordered_map<const Token *, uint32_t> ids;
+    vector<Token *> order;
+    numberTokens(parser.lexer.tokens, ids, order);
+    // only tokens of the tree can be stored, anything else means the entry would be wrong
+    auto failed = false;
+    auto id = [&](const Token *token) -> uint32_t {
+        if (token == nullptr) {
+            return NO_INDEX;
+        }
+        auto it = ids.find(token);
+        if (it == ids.end()) {
+            failed = true;
+            return NO_INDEX;
+        }
+        return it->second;
+    };
+    auto &ast = parser.ast;
+    vector<uint32_t> nodeTokens(ast.size()), tokenLists(ast.tokenLists.size()), blocks;
+    for (size_t i = 0; i < ast.size(); i++) {
+        nodeTokens[i] = id(ast.tokens[i]);
+    }
+    for (size_t i = 0; i < ast.tokenLists.size(); i++) {
+        tokenLists[i] = id(ast.tokenLists[i]);
+    }
+    for (auto &block: parser.blocks) {
+        blocks.push_back(id(block.first));
+        blocks.push_back(block.second);
+    }
+    if (failed || ast.size() >= NO_INDEX || ast.extra.size() >= NO_INDEX) {
+        return;
+    }
+
+    vector<CachedToken> tokens(order.size());
+    vector<uint32_t> children;
+    unordered_map<Atom, uint32_t> nameIds;
+    vector<uint32_t> names;
+    for (uint32_t i = 0; i < order.size(); i++) {
+        auto token = order[i];
+        auto &cached = tokens[i];
+        cached.type = token->type;
+        cached.start = token->start;
+        cached.end = token->end;
+        cached.name = NO_INDEX;
+        if (token->atom != A_NONE) {
+            auto it = nameIds.find(token->atom);
+            if (it == nameIds.end()) {
+                it = nameIds.emplace(token->atom, names.size()).first;
+                names.push_back(i);
+            }
+            cached.name = it->second;
+        }
+        cached.parent = token->parent == nullptr ? NO_INDEX : ids[token->parent];
+        cached.children = 0;
+        cached.childCount = 0;
+        if (token->type == T_GROUP) {
+            cached.children = children.size();
+            cached.childCount = token->children.size();
+            for (auto child: token->children) {
+                children.push_back(ids[child]);
+            }
+        }
+    }
+    CacheHeader header{};
+    memcpy(header.magic, cacheMagic, 4);
+    header.version = PARSE_CACHE_VERSION;
+    header.hash = hashBytes(source->code, PARSE_CACHE_VERSION);
+    header.size = source->code.size();
+    header.tokenCount = tokens.size();
+    header.topLevel = children.size();
+    header.topLevelCount = parser.lexer.tokens.size();
+    for (auto token: parser.lexer.tokens) {
+        children.push_back(ids[token]);
+    }
+    header.childCount = children.size();
+    header.nameCount = names.size();
+    header.nodeCount = ast.size();
+    header.extraCount = ast.extra.size();
+    header.tokenListCount = tokenLists.size();
+    header.blockCount = parser.blocks.size();
+    header.root = parser.root;
+
+    string payload;
+    payload.append((const char *) tokens.data(), tokens.size() * sizeof(CachedToken));
+    payload.append((const char *) children.data(), children.size() * sizeof(uint32_t));
+    payload.append((const char *) names.data(), names.size() * sizeof(uint32_t));
+    payload.append((const char *) nodeTokens.data(), nodeTokens.size() * sizeof(uint32_t));
+    payload.append((const char *) ast.lhs.data(), ast.lhs.size() * sizeof(uint32_t));
+    payload.append((const char *) ast.rhs.data(), ast.rhs.size() * sizeof(uint32_t));
+    payload.append((const char *) ast.extra.data(), ast.extra.size() * sizeof(uint32_t));
+    payload.append((const char *) tokenLists.data(), tokenLists.size() * sizeof(uint32_t));
+    payload.append((const char *) blocks.data(), blocks.size() * sizeof(uint32_t));
+    payload.append((const char *) ast.kinds.data(), ast.kinds.size());
+    payload.append((const char *) ast.flags.data(), ast.flags.size());
+    header.checksum = hashBytes(payload);
+
+    // written next to the entry and renamed over it, so a concurrent run never maps half of it
+    error_code error;
+    filesystem::create_directories(directory, error);
+    auto path = entryPath(source);
+    auto temporary = path + ".tmp";
+    ofstream file(temporary, ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    file.write((const char *) &header, sizeof(header));
+    file.write(payload.data(), payload.size());
+    file.close();
+    if (!file) {
+        filesystem::remove(temporary, error);
+        return;
+    }
+    filesystem::rename(temporary, path, error);
+}
+
+bool ParseCache::load(Parser &parser) const {
+    auto source = parser.lexer.source.get();
+    auto entry = Source::load(entryPath(source));
+    if (entry == nullptr || entry->code.size() < sizeof(CacheHeader)) {
+        return false;
+    }
+    auto data = entry->code.data();
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, cacheMagic, 4) != 0 || header.version != PARSE_CACHE_VERSION ||
+        header.size != source->code.size() || header.hash != hashBytes(source->code, PARSE_CACHE_VERSION)) {
+        return false;
+    }
+    size_t expected = sizeof(CacheHeader) + (size_t) header.tokenCount * sizeof(CachedToken) +
+                      ((size_t) header.childCount + header.nameCount + 3 * (size_t) header.nodeCount +
+                       header.extraCount + header.tokenListCount + 2 * (size_t) header.blockCount) * sizeof(uint32_t) +
+                      2 * (size_t) header.nodeCount;
+    if (entry->code.size() != expected || (size_t) header.topLevel + header.topLevelCount > header.childCount ||
+        header.checksum != hashBytes(data + sizeof(CacheHeader), expected - sizeof(CacheHeader))) {
+        return false;
+    }
+    auto cached = (const CachedToken *) (data + sizeof(CacheHeader));
+    auto children = (const uint32_t *) (cached + header.tokenCount);
+    auto names = children + header.childCount;
+    auto nodeTokens = names + header.nameCount;
+    auto lhs = nodeTokens + header.nodeCount;
+    auto rhs = lhs + header.nodeCount;
+    auto extra = rhs + header.nodeCount;
+    auto tokenLists = extra + header.extraCount;
+    auto blocks = tokenLists + header.tokenListCount;
+    auto kinds = (const uint8_t *) (blocks + 2 * (size_t) header.blockCount);
+    auto flags = kinds + header.nodeCount;
+
+    auto &lexer = parser.lexer;
+    auto code = source->code;
+    vector<Atom> atoms(header.nameCount);
+    for (uint32_t i = 0; i < header.nameCount; i++) {
+        if (names[i] >= header.tokenCount || cached[names[i]].end > code.size() ||
+            cached[names[i]].start > cached[names[i]].end) {
+            return false;
+        }
+        atoms[i] = atomTable.intern(code.substr(cached[names[i]].start, cached[names[i]].end - cached[names[i]].start));
+    }
+
+    // every token and every child list in one allocation each
+    auto tokens = lexer.arena->makeArray<Token>(header.tokenCount);
+    auto lists = lexer.arena->makeArray<Token *>(header.childCount);
+    for (uint32_t i = 0; i < header.tokenCount; i++) {
+        auto &c = cached[i];
+        if (c.end > code.size() || c.start > c.end || (c.name != NO_INDEX && c.name >= header.nameCount) ||
+            (c.parent != NO_INDEX && c.parent >= header.tokenCount) ||
+            (size_t) c.children + c.childCount > header.childCount) {
+            return false;
+        }
+        auto token = new(tokens + i) Token((TokenType) c.type, source, c.start, c.end,
+                                           code.substr(c.start, c.end - c.start));
+        token->atom = c.name == NO_INDEX ? (Atom) A_NONE : atoms[c.name];
+        token->parent = c.parent == NO_INDEX ? nullptr : tokens + c.parent;
+        token->children = TokenList(lists + c.children, c.childCount);
+    }
+    for (uint32_t i = 0; i < header.childCount; i++) {
+        if (children[i] >= header.tokenCount) {
+            return false;
+        }
+        lists[i] = tokens + children[i];
+    }
+
+    // the columns are taken as they are, only the tokens are turned back into pointers
+    auto token = [&](uint32_t id, bool &ok) -> Token * {
+        if (id == NO_INDEX) {
+            return nullptr;
+        }
+        ok = ok && id < header.tokenCount;
+        return id < header.tokenCount ? tokens + id : nullptr;
+    };
+    auto ok = true;
+    Ast ast;
+    ast.kinds.assign((const NodeKind *) kinds, (const NodeKind *) kinds + header.nodeCount);
+    ast.flags.assign(flags, flags + header.nodeCount);
+    ast.lhs.assign(lhs, lhs + header.nodeCount);
+    ast.rhs.assign(rhs, rhs + header.nodeCount);
+    ast.extra.assign(extra, extra + header.extraCount);
+    ast.tokens.resize(header.nodeCount);
+    for (uint32_t i = 0; i < header.nodeCount; i++) {
+        ast.tokens[i] = token(nodeTokens[i], ok);
+    }
+    ast.tokenLists.resize(header.tokenListCount);
+    for (uint32_t i = 0; i < header.tokenListCount; i++) {
+        ast.tokenLists[i] = token(tokenLists[i], ok);
+        ok = ok && ast.tokenLists[i] != nullptr;
+    }
+    unordered_map<Token *, uint32_t> blockSlots;
+    for (uint32_t i = 0; i < header.blockCount; i++) {
+        auto group = token(blocks[2 * i], ok);
+        auto slot = blocks[2 * i + 1];
+        ok = ok && group != nullptr && slot < header.extraCount && header.extraCount - slot >= 2;
+        blockSlots[group] = slot;
+    }
+    if (!ok || !validTree(ast, header.root)) {
+        return false;
+    }
+    lexer.tokens = TokenList(lists + header.topLevel, header.topLevelCount);
+    parser.ast = std::move(ast);
+    parser.root = header.root;
+    parser.blocks = std::move(blockSlots);
+    return true;
+}
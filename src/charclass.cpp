@@ -0,0 +1,87 @@
+#include "charclass.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define BLOCK 32
+typedef __m256i Vec;
+#define load(p) _mm256_loadu_si256((const __m256i *) (p))
+#define splat(c) _mm256_set1_epi8(c)
+#define eq(a, b) _mm256_cmpeq_epi8(a, b)
+#define gt(a, b) _mm256_cmpgt_epi8(a, b)
+#define vor(a, b) _mm256_or_si256(a, b)
+#define vand(a, b) _mm256_and_si256(a, b)
+#define mask(v) ((uint32_t) _mm256_movemask_epi8(v))
+#elif defined(__SSE2__)
+#define BLOCK 16
+typedef __m128i Vec;
+#define load(p) _mm_loadu_si128((const __m128i *) (p))
+#define splat(c) _mm_set1_epi8(c)
+#define eq(a, b) _mm_cmpeq_epi8(a, b)
+#define gt(a, b) _mm_cmpgt_epi8(a, b)
+#define vor(a, b) _mm_or_si128(a, b)
+#define vand(a, b) _mm_and_si128(a, b)
+#define mask(v) ((uint32_t) _mm_movemask_epi8(v))
+#endif
+
+#ifdef BLOCK
+#define FULL_MASK (BLOCK == 32 ? 0xFFFFFFFFu : 0xFFFFu)
+
+// signed compares are fine here, bytes >= 0x80 are negative and never inside an ascii range
+static inline Vec inRange(Vec v, char lo, char hi) {
+    return vand(gt(v, splat((char) (lo - 1))), gt(splat((char) (hi + 1)), v));
+}
+
+// Scans blocks while every byte matches, the matching bytes of each block are given by match(v) as a mask.
+#define SCAN_RUN(p, end, match)                                   \
+    while (end - p >= BLOCK) {                                    \
+        Vec v = load(p);                                          \
+        uint32_t m = ~mask(match) & FULL_MASK;                    \
+        if (m != 0) return p + __builtin_ctz(m);                  \
+        p += BLOCK;                                               \
+    }
+#endif
+
+const char *skipWhitespace(const char *p, const char *end) {
+    // most whitespace runs are a single space, don't pay for a vector load on those
+    if (p < end && !isCharClass(*p, C_WHITESPACE)) return p;
+#ifdef BLOCK
+    SCAN_RUN(p, end, vor(vor(eq(v, splat(' ')), eq(v, splat('\t'))), vor(eq(v, splat('\r')), eq(v, splat('\v')))))
+#endif
+    while (p < end && isCharClass(*p, C_WHITESPACE)) p++;
+    return p;
+}
+
+const char *skipIdentifier(const char *p, const char *end) {
+#ifdef BLOCK
+    SCAN_RUN(p, end, vor(vor(inRange(vor(v, splat(0x20)), 'a', 'z'), inRange(v, '0', '9')), eq(v, splat('_'))))
+#endif
+    while (p < end && isCharClass(*p, C_IDENTIFIER)) p++;
+    return p;
+}
+
+const char *skipDigits(const char *p, const char *end) {
+#ifdef BLOCK
+    SCAN_RUN(p, end, inRange(v, '0', '9'))
+#endif
+    while (p < end && isCharClass(*p, C_DIGIT)) p++;
+    return p;
+}
+
+const char *findEither(const char *p, const char *end, char a, char b) {
+#ifdef BLOCK
+    Vec va = splat(a), vb = splat(b);
+    while (end - p >= BLOCK) {
+        Vec v = load(p);
+        uint32_t m = mask(vor(eq(v, va), eq(v, vb)));
+        if (m != 0) return p + __builtin_ctz(m);
+        p += BLOCK;
+    }
+#endif
+    while (p < end && *p != a && *p != b) p++;
+    return p;
+}
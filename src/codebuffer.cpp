@@ -0,0 +1,14 @@
+#include "codebuffer.hpp"
+
+using namespace std;
+
+void CodeBuffer::write(ostream &out, const vector<string> &symbols) const {
+    size_t written = 0;
+    for (auto &placeholder: placeholders) {
+        out.write(text.data() + written, placeholder.offset - written);
+        auto &symbol = symbols[placeholder.symbol];
+        out.write(symbol.data(), symbol.size());
+        written = placeholder.offset;
+    }
+    out.write(text.data() + written, text.size() - written);
+}
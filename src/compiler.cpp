@@ -1,31 +1,51 @@
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <sstream>
+#include "buildcache.hpp"
 #include "compiler.hpp"
+#include "error.hpp"
+#include "hash.hpp"
+
+#ifdef WIN32
+#define OS_NAME "windows"
+#define BINARY "output/main.exe"
+#define RUN_BINARY ".\\output\\main.exe"
+#define DISCARD " > NUL"
+#else
+#ifdef __APPLE__
+#define OS_NAME "macos"
+#else
+#define OS_NAME "linux"
+#endif
+#define BINARY "output/main"
+#define RUN_BINARY "./output/main"
+#define DISCARD " > /dev/null"
+#endif
+
+// where the profiled run of a PGO build leaves its counts
+#define PROFILE_DIRECTORY "output/.profile"
 
 #define FUNCTION_PARAMETERS "NeoObject *this, NeoObject **args, size_t arg_count, NeoHashMap *kwargs"
 
-unordered_map<string, int> operatorPrecedence = {
-        {"**", 4},
-        {"*",  3},
-        {"/",  3},
-        {"%",  3},
-        {"+",  2},
-        {"-",  2},
-        {"==", 1},
-        {"!=", 1},
-        {">",  1},
-        {"<",  1},
-        {">=", 1},
-        {"<=", 1},
-        {"||", 0},
-        {"&&", 0}
-};
 unordered_map<string, string> operatorNames = {
         {"+",  "add"},
         {"-",  "subtract"},
         {"*",  "multiply"},
         {"/",  "divide"},
         {"%",  "modulo"},
-        {"**", "pow"},
+        {"**", "power"},
+        {"&",  "bit_and"},
+        {"|",  "bit_or"},
+        {"^",  "xor"},
+        {"<<", "shift_left"},
+        {">>", "shift_right"},
+        {"~",  "bit_not"},
+        {"!",  "not"},
         {"==", "equals"},
         {"!=", "not_equals"},
         {">",  "greater_than"},
@@ -36,13 +56,159 @@ unordered_map<string, string> operatorNames = {
         {"&&", "and"}
 };
 
+// The shortest text that reads back as number, as a C double literal.
+static string doubleLiteral(double number) {
+    char text[32];
+    for (int precision = 15; precision <= 17; precision++) {
+        snprintf(text, sizeof(text), "%.*g", precision, number);
+        if (strtod(text, nullptr) == number) {
+            break;
+        }
+    }
+    string literal(text);
+    if (literal.find_first_of(".e") == string::npos) {
+        literal += ".0";
+    }
+    return literal;
+}
+
+static CompileTimeValue intConstant(int64_t integer) {
+    return {CTV_CONSTANT, "", {CONSTANT_INT, integer}};
+}
+
+static CompileTimeValue doubleConstant(double number) {
+    return {CTV_CONSTANT, "", {CONSTANT_DOUBLE, 0, number}};
+}
+
+// The runtime computes ints in a C int, folds of results it can't hold are left to it.
+static bool fitsInt(int64_t integer) {
+    return integer >= INT32_MIN && integer <= INT32_MAX;
+}
+
+// What the runtime makes of op on a, false when that is not a constant or is left to the runtime.
+static bool foldUnary(const string &op, const Constant &a, CompileTimeValue &result) {
+    if (a.type == CONSTANT_INT && (op == "-" || op == "~")) {
+        auto integer = op == "-" ? -a.integer : ~a.integer;
+        result = intConstant(integer);
+        return fitsInt(integer);
+    }
+    if (a.type == CONSTANT_DOUBLE && op == "-") {
+        result = doubleConstant(-a.number);
+        return true;
+    }
+    return false;
+}
+
+// What the runtime makes of a op b, false when that is not a constant or is left to the runtime: results a C int
+// doesn't hold, results that are not finite and the errors. Joined strings are kept in literals.
+static bool foldBinary(const string &op, const Constant &a, const Constant &b, deque<string> &literals,
+                       CompileTimeValue &result) {
+    if (a.type == CONSTANT_STRING || b.type == CONSTANT_STRING) {
+        // C joins adjacent literals as NEO_add joins strings
+        if (op != "+" || a.type != b.type) {
+            return false;
+        }
+        auto &joined = literals.emplace_back(a.literal);
+        joined += ' ';
+        joined += b.literal;
+        result = {CTV_CONSTANT, "", {CONSTANT_STRING, 0, 0, joined}};
+        return true;
+    }
+    // an int is compared with a double as a double, every C int is one exactly
+    double x = a.type == CONSTANT_INT ? (double) a.integer : a.number;
+    double y = b.type == CONSTANT_INT ? (double) b.integer : b.number;
+    int comparison = op == "==" ? x == y : op == "!=" ? x != y : op == ">" ? x > y : op == "<" ? x < y :
+                     op == ">=" ? x >= y : op == "<=" ? x <= y : -1;
+    if (comparison != -1) {
+        result = {CTV_VARIABLE, comparison ? "NeoTrue" : "NeoFalse"};
+        return true;
+    }
+    if (op == "/") {
+        // int / int is a double too
+        result = doubleConstant(x / y);
+        return isfinite(x / y);
+    }
+    if (a.type == CONSTANT_INT && b.type == CONSTANT_INT) {
+        auto l = a.integer;
+        auto r = b.integer;
+        int64_t integer;
+        if (op == "+") {
+            integer = l + r;
+        } else if (op == "-") {
+            integer = l - r;
+        } else if (op == "*") {
+            integer = l * r;
+        } else if (op == "%" && r != 0 && !(l == INT32_MIN && r == -1)) {
+            integer = l % r;
+        } else if (op == "**") {
+            // pow of the two, cut to an int
+            auto power = pow((double) l, (double) r);
+            if (!(power > INT32_MIN - 1.0 && power < INT32_MAX + 1.0)) {
+                return false;
+            }
+            integer = (int64_t) power;
+        } else if (op == "&") {
+            integer = l & r;
+        } else if (op == "|") {
+            integer = l | r;
+        } else if (op == "^") {
+            integer = l ^ r;
+        } else if (op == "<<" && r >= 0 && r < 32 && l >= 0) {
+            integer = l << r;
+        } else if (op == ">>" && r >= 0 && r < 32) {
+            integer = l >> r;
+        } else {
+            return false;
+        }
+        result = intConstant(integer);
+        return fitsInt(integer);
+    }
+    double number;
+    if (op == "+") {
+        number = x + y;
+    } else if (op == "-") {
+        number = x - y;
+    } else if (op == "*") {
+        number = x * y;
+    } else if (op == "%") {
+        number = fmod(x, y);
+    } else if (op == "**") {
+        number = pow(x, y);
+    } else {
+        return false;
+    }
+    result = doubleConstant(number);
+    return isfinite(number);
+}
+
+// The type a value has in C, a number constant is written as a C one.
+static NativeType nativeType(const CompileTimeValue &value) {
+    if (value.type == CTV_CONSTANT) {
+        return value.constant.type == CONSTANT_INT ? NATIVE_INT :
+               value.constant.type == CONSTANT_DOUBLE ? NATIVE_DOUBLE : NATIVE_NONE;
+    }
+    return value.type == CTV_NATIVE || value.type == CTV_NATIVE_VARIABLE ? value.native : NATIVE_NONE;
+}
+
+// The C value of a native value or a number constant.
+static string nativeText(const CompileTimeValue &value) {
+    if (value.type != CTV_CONSTANT) {
+        return value.pointer;
+    }
+    return value.constant.type == CONSTANT_INT ? to_string(value.constant.integer) :
+           doubleLiteral(value.constant.number);
+}
+
 void Scope::append(string code, bool indent) {
-    fnCode += (indent ? indentStr : "") + code;
+    if (indent) {
+        fnCode += indentStr;
+    }
+    fnCode += code;
 }
 
 void Scope::clearVariables() {
     for (auto it = variables.begin(); it != variables.end(); ++it) {
-        if (it->second.isFunction || returning.pointer == it->second.pointer) continue;
+        if (it->second.isFunction || it->second.pointer.empty() || returning.pointer == it->second.pointer) continue;
         append("NEO_dereference(" + it->second.pointer + ");\n");
     }
 }
@@ -55,333 +221,383 @@ void Scope::clearTemp() {
     temp.clear();
 }
 
-VariableDefinition *Scope::getVariableDefinition(string name) {
+VariableDefinition *Scope::getVariableDefinition(Atom name) {
     auto scope = this;
     while (scope != nullptr) {
-        if (scope->variables.find(name) != scope->variables.end()) {
-            return &scope->variables[name];
+        auto it = scope->variables.find(name);
+        if (it != scope->variables.end()) {
+            return &it->second;
         }
         scope = scope->parent;
     }
     return nullptr;
 }
 
-void Compiler::introduceFunction(Scope *scope, string name, vector<unique_ptr<Statement>> *statements, bool isLambda) {
-    string fnId = isLambda ? "_neo_lambda_" + to_string(++_id) : "_neo_fn_" + to_string(scope->id) + "_" + name;
-    string fnKey = "NeoObject *" + fnId + "(" FUNCTION_PARAMETERS ")";
+void Compiler::introduceFunction(Scope *scope, Atom name, NodeList statements, bool isLambda) {
+    string fnId = isLambda ? "_neo_lambda_" + to_string(++_id)
+                           : "_neo_fn_" + to_string(scope->id) + "_" + string(atomTable.name(name));
+    // named functions don't bind their parameters, the body takes none and the function object wraps it
+    string fnKey = "NeoObject *" + fnId + (isLambda ? "(" FUNCTION_PARAMETERS ")" : "()");
 
     if (!isLambda) {
-        string varId = "_neo_var_" + to_string(scope->id) + "_" + name;
+        string varId = "_neo_var_" + to_string(scope->id) + "_" + string(atomTable.name(name));
+        string objectKey = "NeoObject *" + fnId + "_object(" FUNCTION_PARAMETERS ")";
         globalCode += "NeoObject *" + varId + ";\n";
-        functions["void NEO_initFunctions()"] += "\t" + varId + " = NEO_function(" + fnId + ");\n";
-        functions["void NEO_freeFunctions()"] += "\tNEO_dereference(" + varId + ");\n";
-        scope->variables[name] = VariableDefinition(varId, true, true);
+        globalCode += objectKey + ";\n";
+        functionCode(objectKey) = CodeBuffer();
+        functionCode(objectKey) += "\treturn " + fnId + "();\n";
+        functionCode("void NEO_initFunctions()") += "\t" + varId + " = NEO_function(" + fnId + "_object);\n";
+        functionCode("void NEO_freeFunctions()") += "\tNEO_dereference(" + varId + ");\n";
+        auto &definition = scope->variables[name] = VariableDefinition(varId, true, true);
+        if (!inference.reassigned(name)) {
+            definition.callee = fnId;
+        }
     }
 
     globalCode += fnKey + ";\n";
 
-    functions[fnKey] = "";
-    auto fnScope = new Scope(++_id, functions[fnKey], scope, false);
+    auto &fnCode = functionCode(fnKey) = CodeBuffer();
+    auto fnScope = new Scope(++_id, fnCode, scope, false);
     compileScope(fnScope, statements);
     fnScope->append("return NULL;\n");
     delete fnScope;
 }
 
-void Compiler::compile() {
-    functions["void NEO_initFunctions()"] = "";
-    functions["void NEO_freeFunctions()"] = "";
-    functions["int main(int argc, char *argv[])"] = "\tNEO_init(argc, argv);\n\tNEO_initFunctions();\n";
+CodeBuffer &Compiler::functionCode(const string &signature) {
+    auto it = functions.find(signature);
+    if (it != functions.end()) {
+        return it->second;
+    }
+    functionList.push_back(signature);
+    return functions[signature];
+}
+
+void Compiler::build() {
+    functionCode("void NEO_initFunctions()");
+    functionCode("void NEO_freeFunctions()");
+    functionCode("int main(int argc, char *argv[])") += "\tNEO_init(argc, argv);\n\tNEO_initFunctions();\n";
     globalCode += "void NEO_initFunctions();\n";
     globalCode += "void NEO_freeFunctions();\n";
-    auto mainScope = new Scope(++_id, functions["int main(int argc, char *argv[])"], nullptr, false);
-    compileScope(mainScope, &parser.statements);
-    functions["int main(int argc, char *argv[])"] += "\tNEO_freeFunctions();\n\tNEO_exit(0);\n";
+    auto &mainCode = functionCode("int main(int argc, char *argv[])");
+    inference.infer(parser.statements());
+    auto mainScope = new Scope(++_id, mainCode, nullptr, false);
+    compileScope(mainScope, parser.statements());
+    mainCode += "\tNEO_freeFunctions();\n\tNEO_exit(0);\n";
     delete mainScope;
-    string code = "#include \"../api/include/neo.h\"\n\n" + globalCode + "\n";
-    for (auto f: functions) {
-        code += f.first + " {\n" + f.second + "}\n\n";
+    for (auto &f: missingFunctionDefinitions) {
+        f.errorToken->reportError(
+                "NameError: Function '" + string(atomTable.name(f.functionName)) + "' is not defined");
     }
-    code.pop_back();
-    if (missingFunctionDefinitions.size() > 0) {
-        auto f = missingFunctionDefinitions[0];
-        f.errorToken->throwError(
-                "NameError: Function '" + f.functionName + "' is not defined");
+}
+
+void Compiler::write(ostream &out) const {
+    out << "#include \"../api/include/neo.h\"\n\n" << globalCode;
+    for (auto &signature: functionList) {
+        out << "\n" << signature << " {\n";
+        functions.at(signature).write(out, symbols);
+        out << "}\n";
     }
+}
 
-    ofstream file;
-    file.open("output/main.c");
-    file << code;
-    file.close();
+string Compiler::generate() {
+    build();
+    ostringstream out;
+    write(out);
+    return out.str();
+}
 
-#ifdef WIN32
-#define OS_NAME "windows"
-#else
-#ifdef __APPLE__
-#define OS_NAME "macos"
-#else
-#define OS_NAME "linux"
-#endif
+// The gcc command building BINARY from output/main.c with options and extraFlags, runtime gets the paths it is
+// built against.
+static string buildCommand(const BuildOptions &options, const string &extraFlags, vector<string> &runtime) {
+    string flags;
+    if (options.profile == BUILD_DEBUG) {
+        flags = " -O0 -g";
+    } else if (options.profile == BUILD_RELEASE) {
+        flags = " -O" + to_string(options.level);
+    }
+    if (options.native) {
+        flags += " -march=native";
+    }
+    if (options.lto) {
+        flags += " -flto";
+    }
+    flags += extraFlags;
+
+    // only main.c is compiled when there is a prebuilt runtime, the one of the build or of the build scripts, which
+    // are built with -O2. The runtime sources are compiled with the program for the flags they are not built with,
+    // -O0 -g, another -O level or -march=native, for a PGO build so they are profiled too, and for LTO without an
+    // LTO library.
+    auto prebuilt = options.training.empty() && options.profile != BUILD_DEBUG && !options.native &&
+                    (options.profile != BUILD_RELEASE || options.level == 2);
+    string library;
+    error_code error;
+    if (prebuilt) {
+        if (options.lto) {
+#ifdef NEO_RUNTIME_LTO_LIBRARY
+            if (filesystem::is_regular_file(NEO_RUNTIME_LTO_LIBRARY, error)) {
+                library = NEO_RUNTIME_LTO_LIBRARY;
+            }
 #endif
-    system("gcc output/main.c -Iapi/include api/neo.c api/types/*.c -lgmp -lmpfr -lm -o output/main");
-    //system("gcc output/main.c -Iapi/include -Lapi/build -lneo-" OS_NAME " -lgmp -lmpfr -lm -o output/main");
-#ifdef WIN32
-    system(".\\output\\main.exe");
-#else
-    system("./output/main");
+        } else {
+#ifdef NEO_RUNTIME_LIBRARY
+            if (filesystem::is_regular_file(NEO_RUNTIME_LIBRARY, error)) {
+                library = NEO_RUNTIME_LIBRARY;
+            }
 #endif
+            if (library.empty() && filesystem::is_regular_file("api/build/libneo-" OS_NAME ".a", error)) {
+                library = "api/build/libneo-" OS_NAME ".a";
+            }
+        }
+    }
+    string command = "gcc" + flags + " output/main.c -Iapi/include ";
+    if (!library.empty()) {
+        runtime = {"api/include", library};
+        command += "\"" + library + "\"";
+    } else {
+        runtime = {"api"};
+        command += "api/neo.c api/types/*.c";
+    }
+    return command + " -lgmp -lmpfr -lm -o " BINARY;
+}
+
+// Builds an instrumented binary and runs it on the training input, leaving its profile in PROFILE_DIRECTORY.
+static bool train(const BuildOptions &options) {
+    error_code error;
+    filesystem::remove_all(PROFILE_DIRECTORY, error);
+    vector<string> runtime;
+    auto command = buildCommand(options, " -fprofile-generate=" PROFILE_DIRECTORY, runtime);
+    if (system(command.c_str()) != 0) {
+        return false;
+    }
+    auto run = RUN_BINARY " < \"" + options.training + "\"" DISCARD;
+    if (system(run.c_str()) != 0) {
+        cout << "error: the training run on '" << options.training << "' failed" << endl;
+        return false;
+    }
+    return true;
 }
 
-CompileTimeValue Compiler::executeToken(Scope *scope, Token *t0) {
-    string val;
-    if (t0->type == T_INTERNAL_IDENTIFIER) {
-        return {CTV_VARIABLE, t0->value};
-    } else if (t0->type == T_GROUP && t0->value[0] == '(') {
-        if (t0->children.size() == 0) {
-            t0->throwError("SyntaxError: Expected expression inside parenthesis");
+void Compiler::compile() {
+    build();
+    diagnostics.exitOnErrors();
+
+    ofstream file;
+    file.open("output/main.c");
+    HashingBuffer hashing(file.rdbuf());
+    ostream out(&hashing);
+    write(out);
+    auto codeHash = hashing.hash();
+    file.close();
+
+    vector<string> runtime;
+    string profileFlags;
+    if (!options.training.empty()) {
+        // functions the training never reached have no counts, they are optimized as without a profile
+        profileFlags = " -fprofile-use=" PROFILE_DIRECTORY " -fprofile-partial-training -Wno-missing-profile";
+    }
+    auto command = buildCommand(options, profileFlags, runtime);
+    if (!options.training.empty()) {
+        // the profile follows from the training input, which stands for it in the key
+        runtime.push_back(options.training);
+    }
+    BuildCache cache;
+    auto key = BuildCache::key(codeHash, command, runtime);
+    if (!cache.load(key, BINARY)) {
+        if (!options.training.empty() && !train(options)) {
+            return;
         }
-        return executeExpression(scope, t0->children);
-    } else if (t0->type == T_IDENTIFIER) {
-        if (t0->value == "print") {
-            return {CTV_VARIABLE, "NeoGlobPrint"};
+        if (system(command.c_str()) != 0) {
+            return;
         }
-        if (t0->value == "input") {
-            return {CTV_VARIABLE, "NeoGlobInput"};
+        cache.save(key, BINARY);
+    }
+    system(RUN_BINARY);
+}
+
+CompileTimeValue Compiler::executeIdentifier(Scope *scope, Token *token) {
+    if (token->atom == A_PRINT) {
+        return {CTV_VARIABLE, "NeoGlobPrint"};
+    }
+    if (token->atom == A_INPUT) {
+        return {CTV_VARIABLE, "NeoGlobInput"};
+    }
+    if (token->atom == A_TRUE) {
+        return {CTV_VARIABLE, "NeoTrue"};
+    }
+    if (token->atom == A_FALSE) {
+        return {CTV_VARIABLE, "NeoFalse"};
+    }
+    VariableDefinition *def = scope->getVariableDefinition(token->atom);
+    if (def == nullptr) {
+        return {CTV_INVALID_VARIABLE};
+    }
+    if (def->value.type == CTV_CONSTANT || def->value.type == CTV_NATIVE_VARIABLE) {
+        return def->value;
+    }
+    return {CTV_VARIABLE, def->pointer};
+}
+
+CompileTimeValue Compiler::executeLiteral(Token *token) {
+    // what NEO_int, NEO_double and NEO_string3 make is a constant, the big numbers go to the pool right away
+    CompileTimeValue value = {CTV_CONSTANT};
+    string text(token->value);
+    bool is_big = text.find('n') != string::npos;
+    char *end;
+    if (token->type == T_STRING) {
+        if (text[0] == '"') {
+            value.constant = {CONSTANT_STRING, 0, 0, token->value};
+            if (text.find_first_of("\r\n") != string::npos) {
+                value.constant.literal = literals.emplace_back(stringLiteral(text));
+            }
+            return value;
         }
-        if (t0->value == "true") {
-            return {CTV_VARIABLE, "NeoTrue"};
+    } else if (text.find('.') == string::npos && text.find('e') == string::npos) {
+        errno = 0;
+        auto integer = strtoll(text.c_str(), &end, 0); // read as C reads the literal
+        if (!is_big && *end == '\0' && errno == 0 && integer >= INT32_MIN && integer <= INT32_MAX) {
+            value.constant = {CONSTANT_INT, integer, 0, token->value};
+            return value;
         }
-        if (t0->value == "false") {
-            return {CTV_VARIABLE, "NeoFalse"};
+    } else {
+        auto number = strtod(text.c_str(), &end);
+        if (!is_big && *end == '\0' && isfinite(number)) {
+            value.constant = {CONSTANT_DOUBLE, 0, number, token->value};
+            return value;
         }
-        VariableDefinition *def = scope->getVariableDefinition(t0->value);
-        if (def == nullptr) {
-            return {CTV_INVALID_VARIABLE};
+    }
+
+    string allocation;
+    if (token->type == T_STRING) {
+        allocation = "NEO_string3(" + stringLiteral(token->value) + ")";
+    } else if (text.find('.') == string::npos && text.find('e') == string::npos) {
+        if (is_big) {
+            // big int
+            allocation = "NEO_bigint_str(\"" + text + "\")";
+        } else {
+            // int32
+            allocation = "NEO_int(" + text + ")";
         }
-        return {CTV_VARIABLE, def->pointer};
     } else {
-        string store = "_neo_temp_" + to_string(++_id);
-        if (t0->type == T_NUMBER) {
-            bool is_big = t0->value.find('n') != string::npos;
-            if (t0->value.find('.') == string::npos && t0->value.find('e') == string::npos) {
-                if (is_big) {
-                    // big int
-                    scope->append("NeoObject *" + store + " = NEO_bigint_str(\"" + t0->value + "\");" + "\n");
-                } else {
-                    // int32
-                    scope->append("NeoObject *" + store + " = NEO_int(" + t0->value + ");" + "\n");
-                }
-            } else {
-                // double
-                if (is_big) {
-                    scope->append("NeoObject *" + store + " = NEO_bigfloat_str(\"" + t0->value + "\");" + "\n");
-                } else {
-                    scope->append("NeoObject *" + store + " = NEO_double(" + t0->value + ");" + "\n");
-                }
-            }
-            return {CTV_TEMP, store};
-        } else if (t0->type == T_STRING) {
-            scope->append("NeoObject *" + store + " = NEO_string3(" + t0->value + ");" + "\n");
-            return {CTV_TEMP, store};
-        } else if (t0->type == T_GROUP) {
-            if (t0->value[0] == '[') {
-                scope->append("NeoObject *" + store + " = NEO_array();" + "\n");
-                auto values = splitTokens(t0->children, ",", true);
-                for (auto &value: values) {
-                    if (value.size() == 0) {
-                        t0->throwError("SyntaxError: Invalid array value");
-                    }
-                    auto valueStore = executeExpression(scope, value);
-                    scope->append("internal_NEO_array_push(" + store + ", " + valueStore.pointer + ");\n");
-                    scope->append("NEO_dereference(" + valueStore.pointer + ");\n");
-                }
-                return {CTV_TEMP, store};
-            } else if (t0->value[0] == '{') {
-                scope->append("NeoObject *" + store + " = NEO_object();" + "\n");
-                auto values = splitTokens(t0->children, ",", true);
-                for (auto &value: values) {
-                    auto kv = splitTokens(value, ":", true);
-                    if (kv.size() != 2) {
-                        kv[0][0]->throwError("SyntaxError: Invalid key-value pair.");
-                    }
-                    if (kv[0].size() != 1) {
-                        kv[0][0]->throwError("SyntaxError: Invalid object key.");
-                    }
-                    auto key = kv[0][0];
-                    auto valueStore = executeExpression(scope, kv[1]);
-                    if (key->type == T_IDENTIFIER || key->type == T_STRING) {
-                        auto keyValue = key->value;
-                        if (key->type == T_IDENTIFIER) {
-                            keyValue = "\"" + key->value + "\"";
-                        }
-                        scope->append(
-                                "NEO_set_object_property(" + store + ", " + keyValue + ", " + valueStore.pointer +
-                                ");\n");
-                        scope->append("NEO_dereference(" + valueStore.pointer + ");\n");
-                    } else if (key->type == T_GROUP && key->value[0] == '[') {
-                        auto keyStore = executeExpression(scope, key->children);
-                        string tempStr = "_neo_temp_" + to_string(++_id);
-                        scope->append("char *" + tempStr + " = NEO_to_string(" + keyStore.pointer + ");\n");
-                        scope->append("NEO_set_object_property(" + store + ", " + tempStr + ", " + valueStore.pointer +
-                                      ");\n");
-                        scope->append("free(" + tempStr + ");\n");
-                        scope->append("NEO_dereference(" + keyStore.pointer + ");\n");
-                        scope->append("NEO_dereference(" + valueStore.pointer + ");\n");
-                    } else {
-                        key->throwError("SyntaxError: Invalid object key.");
-                    }
-                }
-                return {CTV_TEMP, store};
-            } else {
-                t0->throwError("Assumption failed");
-                return {};
-            }
-        } else {
-            t0->throwError("SyntaxError: Unexpected token '" + t0->value + "'");
-            return {};
-        }
-    }
-}
-
-CompileTimeValue Compiler::executeSingleExpression(Scope *scope, vector<Token *> tokens) {
-    // unary operations: !, ~, -, +, ++, --
-    // check if the first token is one of them and use the rest as the expression
-    if (tokens.size() == 0) {
-        cout << "Untraceable empty expression" << endl;
-        exit(1);
-    }
-    auto t0 = tokens[0];
-    if (t0->value == "!" || t0->value == "~" || t0->value == "-" || t0->value == "+" || t0->value == "++" ||
-        t0->value == "--") {
-        string op = t0->value;
-        tokens.erase(tokens.begin());
-        auto val = executeSingleExpression(scope, tokens);
-        if (op == "!" || op == "~") {
-            string temp = "_neo_temp_" + to_string(++_id);
-            scope->append("NeoObject *" + temp + " = NEO_" + operatorNames[op] + "(" + val.pointer + ");\n");
-            if (val.type == CTV_TEMP) {
-                scope->append("NEO_dereference(" + val.pointer + ");\n");
-            }
-            return {CTV_TEMP, temp};
-        } else if (op == "+") {
-            return val;
-        } else if (op == "-") {
-            string temp = "_neo_temp_" + to_string(++_id);
-            scope->append("NeoObject *" + temp + " = NEO_negate(" + val.pointer + ");\n");
-            if (val.type == CTV_TEMP) {
-                scope->append("NEO_dereference(" + val.pointer + ");\n");
-            }
-            return {CTV_TEMP, temp};
+        // double
+        if (is_big) {
+            allocation = "NEO_bigfloat_str(\"" + text + "\")";
         } else {
-            string temp = "_neo_temp_" + to_string(++_id);
-            scope->append(
-                    "NeoObject *" + temp + " = NEO_" + (op == "++" ? "add" : "subtract") + "(" + val.pointer + ");\n");
-            if (val.type == CTV_TEMP) {
-                scope->append("NEO_dereference(" + val.pointer + ");\n");
-            }
-            scope->append(val.pointer + " = " + temp + ";\n");
-            return {CTV_TEMP, temp};
+            allocation = "NEO_double(" + text + ")";
         }
     }
-    auto val = executeToken(scope, t0);
-    bool missingFunction = false;
-    if (val.type == CTV_INVALID_VARIABLE) {
-        if (tokens.size() == 1 || tokens[1]->type != T_GROUP || tokens[1]->value[0] != '(') {
-            t0->throwError("SyntaxError: '" + t0->value + "' is not defined");
-            exit(1);
-        } else missingFunction = true;
+    return {CTV_VARIABLE, literal(allocation)};
+}
+
+string Compiler::literal(const string &allocation) {
+    auto &name = literalPool[allocation];
+    if (name.empty()) {
+        name = "_neo_literal_" + to_string(literalPool.size());
+        globalCode += "NeoObject *" + name + ";\n";
+        functionCode("void NEO_initFunctions()") += "\t" + name + " = NEO_immortal(" + allocation + ");\n";
+        functionCode("void NEO_freeFunctions()") += "\tNEO_free_immortal(" + name + ");\n";
     }
+    return name;
+}
 
-    auto tokens_size = tokens.size();
-    for (size_t i = 1; i < tokens_size; i++) {
-        auto t = tokens[i];
-        if (t->value == ".") {
-            if (tokens[i - 1]->value == "." || i == tokens_size - 1) {
-                t->throwError("SyntaxError: Unexpected '.'");
+CompileTimeValue Compiler::executeArray(Scope *scope, NodeId array) {
+    string store = "_neo_temp_" + to_string(++_id);
+    scope->append("NeoObject *" + store + " = NEO_array();" + "\n");
+    for (auto element: ast.list(ast.lhs[array])) {
+        auto valueStore = executeExpression(scope, element);
+        scope->append("internal_NEO_array_push(" + store + ", " + valueStore.pointer + ");\n");
+        scope->append("NEO_dereference(" + valueStore.pointer + ");\n");
+    }
+    return {CTV_TEMP, store};
+}
+
+CompileTimeValue Compiler::executeObject(Scope *scope, NodeId object) {
+    string store = "_neo_temp_" + to_string(++_id);
+    scope->append("NeoObject *" + store + " = NEO_object();" + "\n");
+    for (auto property: ast.list(ast.lhs[object])) {
+        auto key = ast.tokens[property];
+        auto computedKey = ast.lhs[property];
+        auto valueStore = executeExpression(scope, ast.rhs[property]);
+        if (computedKey == NO_NODE) {
+            auto keyValue = stringLiteral(key->value);
+            if (key->type == T_IDENTIFIER) {
+                keyValue = "\"" + keyValue + "\"";
             }
-            continue;
-        }
-        CompileTimeValue newStore = {CTV_TEMP, "_neo_temp_" + to_string(++_id)};
-        scope->append("NeoObject *" + newStore.pointer + ";\n");
-        if (t->type == T_IDENTIFIER) {
-            // indexing
             scope->append(
-                    newStore.pointer + " = NEO_get_object_property(" + val.pointer + ", \"" + t->value + "\");\n");
-            val = newStore;
-        } else if (t->type == T_GROUP && t->value[0] == '(') {
-            vector<CompileTimeValue> args;
-            unordered_map<string, CompileTimeValue> kwargs;
-            for (auto arg: splitTokens(t->children, ",", true)) {
-                if (arg.size() > 2 && arg[0]->type == T_IDENTIFIER && arg[1]->value == ":") {
-                    string key = arg[0]->value;
-                    arg.erase(arg.begin(), arg.begin() + 2);
-                    kwargs[key] = executeExpression(scope, arg);
-                } else {
-                    args.push_back(executeExpression(scope, arg));
-                }
-            }
-            string argsValue = "NULL, 0";
-            string kwargsValue = "NeoEmptyHashmap";
-            if (args.size() > 0) {
-                string argsStore = "_neo_temp_" + to_string(++_id);
-                argsValue = argsStore + ", " + to_string(args.size());
-                scope->append("NeoObject *" + argsStore + "[] = { ");
-                for (size_t j = 0; j < args.size(); j++) {
-                    if (j > 0) scope->fnCode += ", ";
-                    scope->fnCode += args[j].pointer;
-                }
-                scope->fnCode += " };\n";
-            }
-            if (kwargs.size() > 0) {
-                kwargsValue = "_neo_temp_" + to_string(++_id);
-                scope->append("NeoHashMap *" + kwargsValue + " = NEO_create_hashmap(" +
-                              to_string((int) kwargs.size() * 1.33) + ");\n");
-                for (auto kwarg: kwargs) {
-                    scope->append("NEO_hashmap_set(" + kwargsValue + ", \"" + kwarg.first + "\", " +
-                                  kwarg.second.pointer + ");\n");
-                }
-            }
-            string callArguments = argsValue + ", " + kwargsValue;
-            if (missingFunction) {
-                missingFunction = false;
-                scope->append(newStore.pointer + " = NEO_call(");
-                vector<size_t> positions;
-                positions.push_back(scope->fnCode.size());
-                scope->fnCode += ", ";
-                positions.push_back(scope->fnCode.size());
-                scope->fnCode += ", " + callArguments + ");\n";
-                missingFunctionDefinitions.push_back({scope, t0, t0->value, positions});
-                val = newStore;
-            } else {
-                scope->append(
-                        newStore.pointer + " = NEO_call(" + val.pointer + ", " + val.pointer + ", " + callArguments +
-                        ");\n");
-                val = newStore;
-            }
-        } else if (t->type == T_GROUP && t->value[0] == '[') {
-            // bracket indexing
-            if (t->children.size() == 0) {
-                t->throwError("SyntaxError: Expected expression");
-            }
-            auto key = executeExpression(scope, t->children);
+                    "NEO_set_object_property(" + store + ", " + keyValue + ", " + valueStore.pointer + ");\n");
+            scope->append("NEO_dereference(" + valueStore.pointer + ");\n");
+        } else {
+            auto keyStore = executeExpression(scope, computedKey);
             string tempStr = "_neo_temp_" + to_string(++_id);
-            scope->append("char *" + tempStr + " = NEO_to_string(" + key.pointer + ");\n");
-            scope->append("NEO_dereference(" + key.pointer + ");\n");
-            scope->append(newStore.pointer + " = NEO_get_object_property(" + val.pointer + ", " + tempStr + ");\n");
+            scope->append("char *" + tempStr + " = NEO_to_string(" + keyStore.pointer + ");\n");
+            scope->append("NEO_set_object_property(" + store + ", " + tempStr + ", " + valueStore.pointer + ");\n");
             scope->append("free(" + tempStr + ");\n");
-            val = newStore;
+            scope->append("NEO_dereference(" + keyStore.pointer + ");\n");
+            scope->append("NEO_dereference(" + valueStore.pointer + ");\n");
+        }
+    }
+    return {CTV_TEMP, store};
+}
+
+CompileTimeValue Compiler::executeUnary(Scope *scope, NodeId unary) {
+    string op(ast.tokens[unary]->value);
+    auto val = foldExpression(scope, ast.lhs[unary]);
+    if (op == "+") {
+        return val;
+    }
+    CompileTimeValue folded;
+    if (val.type == CTV_CONSTANT && foldUnary(op, val.constant, folded)) {
+        return folded;
+    }
+    auto type = nativeType(val);
+    if (op == "-" && val.type != CTV_CONSTANT && (type == NATIVE_INT || type == NATIVE_DOUBLE)) {
+        string result = "_neo_native_" + to_string(++_id);
+        auto x = nativeText(val);
+        auto slow = "NEO_apply_unary(NEO_negate, " + boxedOperand(scope, val) + ")";
+        if (type == NATIVE_INT) {
+            folded = writeNative(scope, result, type, val.box, "!NEO_native_negate(" + x + ", &" + result + ")", "",
+                                 slow);
         } else {
-            t->throwError("SyntaxError: Unexpected token '" + t->value + "'");
+            folded = writeNative(scope, result, type, val.box, "", "-" + x, slow);
         }
+        releaseBox(scope, val);
+        return folded;
+    }
+    val = materialize(scope, std::move(val));
+    string temp = "_neo_temp_" + to_string(++_id);
+    if (op == "-") {
+        scope->append("NeoObject *" + temp + " = NEO_negate(" + val.pointer + ");\n");
+    } else {
+        scope->append("NeoObject *" + temp + " = NEO_" + operatorNames[op] + "(" + val.pointer + ");\n");
     }
-    return val;
+    if (val.type == CTV_TEMP) {
+        scope->append("NEO_dereference(" + val.pointer + ");\n");
+    }
+    return {CTV_TEMP, temp};
+}
+
+CompileTimeValue Compiler::executeBinary(Scope *scope, NodeId binary) {
+    // operands from left to right, a nested operation is a temporary like any other value
+    string op(ast.tokens[binary]->value);
+    auto av = foldExpression(scope, ast.lhs[binary]);
+    auto bv = foldExpression(scope, ast.rhs[binary]);
+    return operate(scope, op, std::move(av), std::move(bv));
 }
 
-CompileTimeValue Compiler::computeBinaryOperation(Scope *scope, vector<Token *> a, Token *op, vector<Token *> b) {
-    auto av = executeSingleExpression(scope, a);
-    auto bv = executeSingleExpression(scope, b);
+CompileTimeValue Compiler::operate(Scope *scope, const string &op, CompileTimeValue av, CompileTimeValue bv) {
+    CompileTimeValue folded;
+    if (av.type == CTV_CONSTANT && bv.type == CTV_CONSTANT &&
+        foldBinary(op, av.constant, bv.constant, literals, folded)) {
+        return folded;
+    }
+    if (operateNative(scope, op, av, bv, folded)) {
+        return folded;
+    }
+    // constants and native values are pure, writing them after the code of the other operand changes nothing
+    av = materialize(scope, std::move(av));
+    bv = materialize(scope, std::move(bv));
     CompileTimeValue store = {CTV_TEMP, "_neo_temp_" + to_string(++_id)};
-    scope->append("NeoObject *" + store.pointer + " = NEO_" + operatorNames[op->value] + "(" + av.pointer + ", " +
-                  bv.pointer + ");\n");
+    scope->append("NeoObject *" + store.pointer + " = NEO_" + operatorNames[op] + "(" +
+                  av.pointer + ", " + bv.pointer + ");\n");
     if (av.type == CTV_TEMP) {
         scope->append("NEO_dereference(" + av.pointer + ");\n");
     }
@@ -391,223 +607,609 @@ CompileTimeValue Compiler::computeBinaryOperation(Scope *scope, vector<Token *>
     return store;
 }
 
-CompileTimeValue Compiler::executeExpression(Scope *scope, vector<Token *> tokens) {
-    auto sep = separateExpression(tokens);
-    return executeSeparatedExpression(scope, sep);
+CompileTimeValue Compiler::combineAssignment(Scope *scope, Token *op, CompileTimeValue original,
+                                             CompileTimeValue value) {
+    // a += b is a = a + b
+    string name(op->value.substr(0, op->value.size() - 1));
+    return operate(scope, name, std::move(original), std::move(value));
+}
+
+CompileTimeValue Compiler::executeAssignment(Scope *scope, NodeId assignment) {
+    auto op = ast.tokens[assignment];
+    auto compound = op->value != "=";
+    return storeTarget(scope, ast.lhs[assignment], compound, [&](CompileTimeValue original) {
+        auto value = foldExpression(scope, ast.rhs[assignment]);
+        return compound ? combineAssignment(scope, op, original, value) : value;
+    });
 }
 
-CompileTimeValue Compiler::executeSeparatedExpression(Scope *scope, vector<vector<Token *>> sep) {
-    if (sep.size() > 1 && sep[1][0]->type == T_SET_OPERATOR) {
-        if (sep.size() < 3) {
-            sep[1][0]->throwError("SyntaxError: Expected an expression");
+CompileTimeValue Compiler::executeUpdate(Scope *scope, NodeId update, bool used) {
+    // x++ is x += 1 that gives back what x was
+    auto prefix = (ast.flags[update] & F_PREFIX) || !used;
+    CompileTimeValue previous = {CTV_NULL, "NULL"};
+    auto stored = storeTarget(scope, ast.lhs[update], true, [&](CompileTimeValue original) {
+        if (!prefix && original.type == CTV_NATIVE_VARIABLE) {
+            previous = materialize(scope, original);
+        } else if (!prefix) {
+            previous = {CTV_TEMP, "_neo_temp_" + to_string(++_id)};
+            scope->append("NeoObject *" + previous.pointer + " = " + original.pointer + ";\n");
+            scope->append("NEO_reference(" + previous.pointer + ");\n");
         }
-        string op = sep[1][0]->value;
-        if (op == ":=") {
-            sep[1][0]->throwError("SyntaxError: Cannot use ':=' inside expressions");
+        return operate(scope, ast.tokens[update]->value == "++" ? "+" : "-", original, intConstant(1));
+    });
+    if (prefix) {
+        return stored;
+    }
+    if (stored.type == CTV_TEMP) {
+        scope->append("NEO_dereference(" + stored.pointer + ");\n");
+    }
+    return previous;
+}
+
+CompileTimeValue Compiler::storeTarget(Scope *scope, NodeId target, bool readOriginal,
+                                       const function<CompileTimeValue(CompileTimeValue)> &compute) {
+    auto token = ast.tokens[target];
+    if (ast.kinds[target] == E_ARRAY || ast.kinds[target] == E_OBJECT) {
+        // [a, b] = value stores value[0] in a and value[1] in b, {a, b: c} = value value.a in a and value.b in c
+        auto value = materialize(scope, compute({CTV_NULL, "NULL"}));
+        auto elements = ast.list(ast.lhs[target]);
+        for (size_t i = 0; i < elements.size(); i++) {
+            auto element = elements[i];
+            string key = "\"" + to_string(i) + "\"";
+            if (ast.kinds[element] == E_PROPERTY) {
+                auto name = ast.tokens[element];
+                key = stringLiteral(name->value);
+                if (name->type == T_IDENTIFIER) {
+                    key = "\"" + key + "\"";
+                }
+                element = ast.rhs[element];
+            }
+            // what the store gives back is released as the value of an assignment that is not used
+            auto stored = storeTarget(scope, element, false, [&](CompileTimeValue) {
+                CompileTimeValue part = {CTV_TEMP, "_neo_temp_" + to_string(++_id)};
+                scope->append("NeoObject *" + part.pointer + " = NEO_get_object_property(" + value.pointer + ", " +
+                              key + ");\n");
+                return part;
+            });
+            discardValue(scope, stored);
         }
-        CompileTimeValue original;
-        if (op != "=") {
-            original = executeSingleExpression(scope, sep[0]);
+        return value;
+    }
+    if (ast.kinds[target] == E_IDENTIFIER) {
+        auto var = executeIdentifier(scope, token);
+        if (var.type == CTV_INVALID_VARIABLE) {
+            token->reportError("SyntaxError: '" + string(token->value) + "' is not defined");
+            var = {CTV_VARIABLE, "NULL"};
         }
-        auto last = sep[0].back();
-        sep[0].pop_back();
-        CompileTimeValue var;
-        bool isSingle = sep[0].size() == 0;
-        if (isSingle) {
-            var = executeToken(scope, last);
-            if (var.type == CTV_INVALID_VARIABLE) {
-                last->throwError("SyntaxError: '" + last->value + "' is not defined");
-            }
-        } else {
-            var = executeSingleExpression(scope, sep[0]);
+        auto definition = scope->getVariableDefinition(token->atom);
+        if (definition != nullptr && definition->constant && !definition->isFunction) {
+            // constants are folded into their uses, a new value would not reach them
+            token->reportError("SyntaxError: Cannot assign to constant '" + string(token->value) + "'");
         }
-        sep.erase(sep.begin(), sep.begin() + 2);
-        auto value = executeSeparatedExpression(scope, sep);
-        if (op != "=") {
-            string temp = "_neo_temp_" + to_string(++_id);
-            scope->append(
-                    "NeoObject *" + temp + " = NEO_" + operatorNames[string(1, op[0])] + "(" + value.pointer + ", " +
-                    original.pointer + ");\n");
-            if (value.type == CTV_TEMP) {
-                scope->append("NEO_dereference(" + value.pointer + ");\n");
-            }
-            value = {CTV_TEMP, temp};
+        if (var.type == CTV_NATIVE_VARIABLE && var.pointer.empty()) {
+            return compute(var); // never read, see TypeInference::read
         }
-        if (isSingle) {
-            if (var.pointer == value.pointer) {
-                return var; // x = x
-            }
+        if (var.type == CTV_NATIVE_VARIABLE) {
+            storeNative(scope, var, compute(var), false);
+            return var;
+        }
+        var = materialize(scope, std::move(var));
+        auto value = materialize(scope, compute(var));
+        if (var.pointer == value.pointer) {
+            return var; // x = x
+        }
+        if (value.type != CTV_TEMP) {
+            // a temporary is handed over, anything else is shared
             scope->append("NEO_reference(" + value.pointer + ");\n");
-            scope->append("NEO_dereference(" + var.pointer + ");\n");
-            scope->append(var.pointer + " = " + value.pointer + ";\n");
-        } else {
-            if (last->type != T_IDENTIFIER && last->value[0] != '[') {
-                last->throwError("SyntaxError: Invalid indexing operation");
-            }
-            if (last->type == T_IDENTIFIER) {
-                scope->append("NEO_set_object_property(" + var.pointer + ", \"" + last->value + "\", " + value.pointer +
-                              ");\n");
-            } else {
-                auto keyValue = executeExpression(scope, last->children);
-                scope->append("_tempStr = NEO_to_string(" + keyValue.pointer + ");\n");
-                scope->append("NEO_set_object_property(" + var.pointer + ", _tempStr, " + value.pointer + ");\n");
-                scope->append("free(_tempStr);\n");
-            }
         }
-
+        scope->append("NEO_dereference(" + var.pointer + ");\n");
+        scope->append(var.pointer + " = " + value.pointer + ";\n");
         return var;
     }
-    auto len = sep.size();
-    if (len == 1) {
-        return executeSingleExpression(scope, sep[0]);
-    }
-    vector<vector<Token *>> output;
-    vector<vector<Token *>> stack;
-    for (int i = 0; i < len; ++i) {
-        auto chain = sep[i];
-        if (i % 2 == 0) {
-            if (IsAnyOperatorToken(chain[0])) {
-                chain[0]->throwError("SyntaxError: Expected an expression got an operator");
-            }
-            output.push_back(chain);
-            continue;
-        }
-        auto o1 = chain;
-        while (1) {
-            auto o2 = stack.empty() ? vector<Token *>{} : stack.back();
-            if (stack.empty() || (
-                    operatorPrecedence[o2[0]->value] <= operatorPrecedence[o1[0]->value] &&
-                    (operatorPrecedence[o2[0]->value] != operatorPrecedence[o1[0]->value] || o1[0]->value == "**")
-            )) {
-                break;
-            }
-            output.push_back(stack.back());
-            stack.pop_back();
+
+    // object.name = value and object[key] = value
+    CompileTimeValue object, key;
+    string keyValue;
+    if (ast.kinds[target] == E_MEMBER) {
+        object = executeExpression(scope, ast.lhs[target]);
+        keyValue = "\"" + string(token->value) + "\"";
+    } else {
+        object = executeExpression(scope, ast.lhs[target]);
+        key = executeExpression(scope, ast.rhs[target]);
+        keyValue = "_neo_temp_" + to_string(++_id);
+        scope->append("char *" + keyValue + " = NEO_to_string(" + key.pointer + ");\n");
+        if (key.type == CTV_TEMP) {
+            scope->append("NEO_dereference(" + key.pointer + ");\n");
+        }
+    }
+    CompileTimeValue original = {CTV_NULL, "NULL"};
+    if (readOriginal) {
+        original = {CTV_TEMP, "_neo_temp_" + to_string(++_id)};
+        scope->append("NeoObject *" + original.pointer + " = NEO_get_object_property(" + object.pointer + ", " +
+                      keyValue + ");\n");
+    }
+    // compute reads the original, it is dereferenced here
+    auto value = materialize(scope, compute({CTV_VARIABLE, original.pointer}));
+    if (readOriginal) {
+        scope->append("NEO_dereference(" + original.pointer + ");\n");
+    }
+    scope->append("NEO_set_object_property(" + object.pointer + ", " + keyValue + ", " + value.pointer + ");\n");
+    if (value.type == CTV_TEMP) {
+        scope->append("NEO_dereference(" + value.pointer + ");\n");
+    }
+    if (ast.kinds[target] == E_INDEX) {
+        scope->append("free(" + keyValue + ");\n");
+    }
+    return object;
+}
+
+CompileTimeValue Compiler::executeMember(Scope *scope, NodeId member) {
+    auto val = executeExpression(scope, ast.lhs[member]);
+    CompileTimeValue newStore = {CTV_TEMP, "_neo_temp_" + to_string(++_id)};
+    scope->append("NeoObject *" + newStore.pointer + ";\n");
+    scope->append(newStore.pointer + " = NEO_get_object_property(" + val.pointer + ", \"" +
+                  string(ast.tokens[member]->value) + "\");\n");
+    return newStore;
+}
+
+CompileTimeValue Compiler::executeIndex(Scope *scope, NodeId index) {
+    auto val = executeExpression(scope, ast.lhs[index]);
+    CompileTimeValue newStore = {CTV_TEMP, "_neo_temp_" + to_string(++_id)};
+    scope->append("NeoObject *" + newStore.pointer + ";\n");
+    auto key = executeExpression(scope, ast.rhs[index]);
+    string tempStr = "_neo_temp_" + to_string(++_id);
+    scope->append("char *" + tempStr + " = NEO_to_string(" + key.pointer + ");\n");
+    scope->append("NEO_dereference(" + key.pointer + ");\n");
+    scope->append(newStore.pointer + " = NEO_get_object_property(" + val.pointer + ", " + tempStr + ");\n");
+    scope->append("free(" + tempStr + ");\n");
+    return newStore;
+}
+
+CompileTimeValue Compiler::executeCall(Scope *scope, NodeId call) {
+    // calling a name that is not defined yet is patched once its function shows up
+    auto callee = ast.lhs[call];
+    CompileTimeValue val;
+    auto missingFunction = false;
+    // a function that is never reassigned is called as a C function, see introduceFunction
+    string direct;
+    if (ast.kinds[callee] == E_IDENTIFIER) {
+        auto name = ast.tokens[callee];
+        val = executeIdentifier(scope, name);
+        missingFunction = val.type == CTV_INVALID_VARIABLE;
+        auto definition = scope->getVariableDefinition(name->atom);
+        if (definition != nullptr) {
+            direct = definition->callee;
+        }
+    } else {
+        val = executeExpression(scope, callee);
+    }
+    CompileTimeValue newStore = {CTV_TEMP, "_neo_temp_" + to_string(++_id)};
+    scope->append("NeoObject *" + newStore.pointer + ";\n");
+    if (!direct.empty() || (missingFunction && !inference.reassigned(ast.tokens[callee]->atom))) {
+        // the body binds no parameters, the arguments are only written for what they do
+        for (auto argument: ast.list(ast.rhs[call])) {
+            discardExpression(scope, ast.kinds[argument] == E_KEYWORD_ARGUMENT ? ast.lhs[argument] : argument);
+        }
+        scope->append(newStore.pointer + " = ");
+        if (missingFunction) {
+            auto name = ast.tokens[callee];
+            uint32_t symbol = symbols.size();
+            symbols.emplace_back();
+            scope->fnCode.placeholder(symbol);
+            missingFunctionDefinitions.push_back({name, name->atom, symbol});
+        } else {
+            scope->fnCode += direct;
         }
-        stack.push_back(o1);
+        scope->fnCode += "();\n";
+        return newStore;
     }
-    while (!stack.empty()) {
-        output.push_back(stack.back());
-        stack.pop_back();
+    vector<CompileTimeValue> args;
+    unordered_map<string, CompileTimeValue> kwargs;
+    for (auto argument: ast.list(ast.rhs[call])) {
+        if (ast.kinds[argument] == E_KEYWORD_ARGUMENT) {
+            kwargs[string(ast.tokens[argument]->value)] = executeExpression(scope, ast.lhs[argument]);
+        } else {
+            args.push_back(executeExpression(scope, argument));
+        }
     }
-    CompileTimeValue store;
-    for (auto &token: output) {
-        if (!IsAnyOperatorToken(token[0])) {
-            stack.push_back(token);
-            continue;
+    string argsValue = "NULL, 0";
+    string kwargsValue = "NeoEmptyHashmap";
+    if (args.size() > 0) {
+        string argsStore = "_neo_temp_" + to_string(++_id);
+        argsValue = argsStore + ", " + to_string(args.size());
+        scope->append("NeoObject *" + argsStore + "[] = { ");
+        for (size_t j = 0; j < args.size(); j++) {
+            if (j > 0) scope->fnCode += ", ";
+            scope->fnCode += args[j].pointer;
         }
+        scope->fnCode += " };\n";
+    }
+    if (kwargs.size() > 0) {
+        kwargsValue = "_neo_temp_" + to_string(++_id);
+        scope->append("NeoHashMap *" + kwargsValue + " = NEO_create_hashmap(" +
+                      to_string((int) kwargs.size() * 1.33) + ");\n");
+        for (auto kwarg: kwargs) {
+            scope->append("NEO_hashmap_set(" + kwargsValue + ", \"" + kwarg.first + "\", " +
+                          kwarg.second.pointer + ");\n");
+        }
+    }
+    string callArguments = argsValue + ", " + kwargsValue;
+    if (missingFunction) {
+        auto name = ast.tokens[callee];
+        uint32_t symbol = symbols.size();
+        symbols.emplace_back();
+        scope->append(newStore.pointer + " = NEO_call(");
+        scope->fnCode.placeholder(symbol);
+        scope->fnCode += ", ";
+        scope->fnCode.placeholder(symbol);
+        scope->fnCode += ", " + callArguments + ");\n";
+        missingFunctionDefinitions.push_back({name, name->atom, symbol});
+    } else {
+        scope->append(
+                newStore.pointer + " = NEO_call(" + val.pointer + ", " + val.pointer + ", " + callArguments + ");\n");
+    }
+    // the temporaries made for the call, like the boxes of native values
+    for (auto &arg: args) {
+        if (arg.type == CTV_TEMP) {
+            scope->append("NEO_dereference(" + arg.pointer + ");\n");
+        }
+    }
+    for (auto &kwarg: kwargs) {
+        if (kwarg.second.type == CTV_TEMP) {
+            scope->append("NEO_dereference(" + kwarg.second.pointer + ");\n");
+        }
+    }
+    return newStore;
+}
+
+CompileTimeValue Compiler::executeExpression(Scope *scope, NodeId expression) {
+    if (expression == NO_NODE) {
+        return {CTV_NULL, "NULL"};
+    }
+    switch (ast.kinds[expression]) {
+        case E_LITERAL:
+        case E_IDENTIFIER:
+        case E_UNARY:
+        case E_BINARY:
+            return materialize(scope, foldExpression(scope, expression));
+        case E_ARRAY:
+            return executeArray(scope, expression);
+        case E_OBJECT:
+            return executeObject(scope, expression);
+        case E_ASSIGNMENT:
+            return materialize(scope, executeAssignment(scope, expression));
+        case E_UPDATE:
+            return materialize(scope, executeUpdate(scope, expression));
+        case E_MEMBER:
+            return executeMember(scope, expression);
+        case E_INDEX:
+            return executeIndex(scope, expression);
+        case E_CALL:
+            return executeCall(scope, expression);
+        default:
+            return {CTV_NULL, "NULL"};
+    }
+}
 
-        auto right = stack.back();
-        stack.pop_back();
-        if (stack.empty()) {
-            token[0]->throwError("SyntaxError: Expected expression after operator");
+void Compiler::discardExpression(Scope *scope, NodeId expression) {
+    // the value of an assignment or an update is not boxed, nor is a folded or native one
+    auto kind = expression == NO_NODE ? S_EXPRESSION : ast.kinds[expression];
+    auto value = kind == E_ASSIGNMENT ? executeAssignment(scope, expression) :
+                 kind == E_UPDATE ? executeUpdate(scope, expression, false) :
+                 foldExpression(scope, expression);
+    discardValue(scope, value);
+}
+
+void Compiler::discardValue(Scope *scope, const CompileTimeValue &value) {
+    if (value.type == CTV_TEMP) {
+        scope->append("NEO_dereference(" + value.pointer + ");\n");
+    }
+    releaseBox(scope, value);
+}
+
+CompileTimeValue Compiler::foldExpression(Scope *scope, NodeId expression) {
+    if (expression == NO_NODE) {
+        return {CTV_NULL, "NULL"};
+    }
+    switch (ast.kinds[expression]) {
+        case E_LITERAL:
+            return executeLiteral(ast.tokens[expression]);
+        case E_UNARY:
+            return executeUnary(scope, expression);
+        case E_BINARY:
+            return executeBinary(scope, expression);
+        case E_IDENTIFIER: {
+            auto token = ast.tokens[expression];
+            auto val = executeIdentifier(scope, token);
+            if (val.type == CTV_INVALID_VARIABLE) {
+                token->reportError("SyntaxError: '" + string(token->value) + "' is not defined");
+                val = {CTV_VARIABLE, "NULL"}; // keeps compiling to find the other errors, nothing gets written
+            }
+            return val;
         }
-        auto left = stack.back();
-        stack.pop_back();
-        store = computeBinaryOperation(scope, left, token[0], right);
-        stack.push_back({new Token(T_INTERNAL_IDENTIFIER, "", "", 0, store.pointer.size(), store.pointer)});
+        default:
+            return executeExpression(scope, expression);
     }
+}
 
-    for (auto &token: stack) {
-        if (token[0]->type == T_INTERNAL_IDENTIFIER) {
-            delete token[0];
+CompileTimeValue Compiler::materialize(Scope *scope, CompileTimeValue value) {
+    if (value.type == CTV_NATIVE || value.type == CTV_NATIVE_VARIABLE) {
+        string store = "_neo_temp_" + to_string(++_id);
+        if (value.native == NATIVE_BOOL) {
+            scope->append("NeoObject *" + store + " = " + value.pointer + " ? NeoTrue : NeoFalse;\n");
+            return {CTV_VARIABLE, store};
+        }
+        auto type = value.native == NATIVE_INT ? "int" : "double";
+        if (value.box.empty()) {
+            scope->append("NeoObject *" + store + " = NEO_" + type + "(" + value.pointer + ");\n");
+        } else {
+            scope->append("NeoObject *" + store + " = NEO_box_" + type + "(" + value.pointer + ", " + value.box +
+                          ");\n");
+            releaseBox(scope, value);
         }
+        return {CTV_TEMP, store};
+    }
+    if (value.type != CTV_CONSTANT) {
+        return value;
+    }
+    if (!value.pointer.empty()) {
+        value.type = CTV_VARIABLE;
+        return value;
+    }
+    auto &constant = value.constant;
+    string text(constant.literal);
+    if (text.empty()) {
+        text = constant.type == CONSTANT_INT ? to_string(constant.integer) : doubleLiteral(constant.number);
     }
+    auto constructor = constant.type == CONSTANT_INT ? "NEO_int(" :
+                       constant.type == CONSTANT_DOUBLE ? "NEO_double(" : "NEO_string3(";
+    return {CTV_VARIABLE, literal(constructor + text + ")")};
+}
 
-    return store;
+bool Compiler::operateNative(Scope *scope, const string &op, const CompileTimeValue &a, const CompileTimeValue &b,
+                             CompileTimeValue &result) {
+    // constants the folding left are left to the runtime too
+    auto type = binaryType(op, nativeType(a), nativeType(b));
+    if (type == NATIVE_NONE || (a.type == CTV_CONSTANT && b.type == CTV_CONSTANT)) {
+        return false;
+    }
+    string name = "_neo_native_" + to_string(++_id);
+    auto x = nativeText(a);
+    auto y = nativeText(b);
+    // i * i checks the box of i once
+    auto check = a.box.empty() || b.box.empty() || a.box == b.box ? (a.box.empty() ? b.box : a.box) :
+                 a.box + " || " + b.box;
+    auto slow = "NEO_apply(NEO_" + operatorNames[op] + ", " + boxedOperand(scope, a) + ", " + boxedOperand(scope, b) +
+                ")";
+    if (type == NATIVE_BOOL) {
+        // as the runtime, >= is not <, <= is not > and != is not ==
+        auto comparison = op == ">=" ? "!(" + x + " < " + y + ")" :
+                          op == "<=" ? "!(" + x + " > " + y + ")" :
+                          op == "!=" ? "!(" + x + " == " + y + ")" : x + " " + op + " " + y;
+        result = writeNative(scope, name, type, check, "", comparison, slow);
+    } else if (type == NATIVE_INT) {
+        auto fails = "!NEO_native_" + operatorNames[op] + "(" + x + ", " + y + ", &" + name + ")";
+        result = writeNative(scope, name, type, check, fails, "", slow);
+    } else if (op == "/" && nativeType(a) == NATIVE_INT && nativeType(b) == NATIVE_INT) {
+        result = writeNative(scope, name, type, check, "", "(double) " + x + " / (double) " + y, slow);
+    } else {
+        result = writeNative(scope, name, type, check, "", x + " " + op + " " + y, slow);
+    }
+    releaseBox(scope, a);
+    releaseBox(scope, b);
+    return true;
+}
+
+CompileTimeValue Compiler::writeNative(Scope *scope, const string &result, NativeType type, string check,
+                                       const string &fails, const string &fast, const string &slow) {
+    string declaration = type == NATIVE_INT ? "int64_t " : type == NATIVE_DOUBLE ? "double " : "int ";
+    if (!fails.empty()) {
+        check = check.empty() ? fails : check + " || " + fails;
+    }
+    if (check.empty()) {
+        scope->append(declaration + result + " = " + fast + ";\n");
+        return {CTV_NATIVE, result, {}, type};
+    }
+    scope->append(declaration + result + ";\n");
+    string box;
+    if (type != NATIVE_BOOL) {
+        box = "_neo_box_" + to_string(++_id);
+        scope->append("NeoObject *" + box + " = NULL;\n");
+    }
+    scope->append("if (" + check + ") {\n");
+    if (type == NATIVE_BOOL) {
+        scope->append("\t" + result + " = NEO_take_truthy(" + slow + ");\n");
+    } else {
+        scope->append("\t" + box + " = NEO_unbox_" + (type == NATIVE_INT ? "int" : "double") + "(" + slow + ", &" +
+                      result + ");\n");
+    }
+    if (!fast.empty()) {
+        scope->append("} else {\n");
+        scope->append("\t" + result + " = " + fast + ";\n");
+    }
+    scope->append("}\n");
+    return {CTV_NATIVE, result, {}, type, box};
+}
+
+string Compiler::boxedOperand(Scope *scope, const CompileTimeValue &value) {
+    if (value.type == CTV_CONSTANT) {
+        // pooled, dereferencing it does nothing
+        return materialize(scope, value).pointer;
+    }
+    auto type = value.native == NATIVE_INT ? "int" : "double";
+    if (value.box.empty()) {
+        return string("NEO_") + type + "(" + value.pointer + ")";
+    }
+    return string("NEO_box_") + type + "(" + value.pointer + ", " + value.box + ")";
 }
 
-void Compiler::compileScope(Scope *scope, vector<unique_ptr<Statement>> *statements) {
-    for (auto &statement: *statements) {
-        if (statement->type == S_EXPRESSION) {
-            unique_ptr<ExpressionStatement> &st = (unique_ptr<ExpressionStatement> &) statement;
-            auto v = executeExpression(scope, st->expression);
-            if (v.type == CTV_TEMP) {
-                scope->append("NEO_dereference(" + v.pointer + ");\n");
+void Compiler::releaseBox(Scope *scope, const CompileTimeValue &value) {
+    if (value.type == CTV_NATIVE && !value.box.empty()) {
+        scope->append("if (" + value.box + " != NULL) NEO_dereference(" + value.box + ");\n");
+    }
+}
+
+void Compiler::storeNative(Scope *scope, const CompileTimeValue &variable, CompileTimeValue value, bool declare) {
+    if (nativeType(value) != variable.native) {
+        // what the inference did not see coming, the box takes what is not of the type
+        auto boxed = materialize(scope, std::move(value));
+        if (boxed.type != CTV_TEMP) {
+            scope->append("NEO_reference(" + boxed.pointer + ");\n");
+        }
+        auto type = variable.native == NATIVE_INT ? "int" : "double";
+        value = {CTV_NATIVE, "_neo_native_" + to_string(++_id), {}, variable.native,
+                 "_neo_box_" + to_string(++_id)};
+        scope->append(string(variable.native == NATIVE_INT ? "int64_t " : "double ") + value.pointer + ";\n");
+        scope->append("NeoObject *" + value.box + " = NEO_unbox_" + type + "(" + boxed.pointer + ", &" +
+                      value.pointer + ");\n");
+    }
+    if (value.type == CTV_NATIVE_VARIABLE) {
+        if (value.pointer == variable.pointer) {
+            return; // x = x
+        }
+        // shared, referenced before the box of the variable goes in case it is the same
+        scope->append("if (" + value.box + " != NULL) NEO_reference(" + value.box + ");\n");
+    }
+    auto box = value.box.empty() ? "NULL" : value.box;
+    if (declare) {
+        scope->append(string(variable.native == NATIVE_INT ? "int64_t " : "double ") + variable.pointer + " = " +
+                      nativeText(value) + ";\n");
+        scope->append("NeoObject *" + variable.box + " = " + box + ";\n");
+        return;
+    }
+    scope->append("if (" + variable.box + " != NULL) NEO_dereference(" + variable.box + ");\n");
+    scope->append(variable.pointer + " = " + nativeText(value) + ";\n");
+    scope->append(variable.box + " = " + box + ";\n");
+}
+
+void Compiler::compileScope(Scope *scope, NodeList statements) {
+    for (auto statement: statements) {
+        auto kind = ast.kinds[statement];
+        auto token = ast.tokens[statement];
+        if (kind == S_EXPRESSION) {
+            discardExpression(scope, ast.lhs[statement]);
+        } else if (kind == S_VARIABLE_DECLARATION) {
+            string name(token->value);
+            // destructuring patterns have no atom of their own
+            auto atom = token->atom != A_NONE ? token->atom : atomTable.intern(name);
+            if (scope->variables.find(atom) != scope->variables.end()) {
+                token->reportError("SyntaxError: Variable '" + name + "' already defined");
+            }
+            string varId = "_neo_var_" + to_string(scope->id) + "_" + name;
+            auto value = foldExpression(scope, ast.lhs[statement]);
+            VariableDefinition definition(varId, ast.flags[statement] & F_CONSTANT, false);
+            auto native = inference.type(statement);
+            if (definition.constant && value.type == CTV_CONSTANT) {
+                // uses are folded with the value, the variable is there for the others
+                definition.value = value;
+                definition.value.pointer = varId;
+            } else if (native != NATIVE_NONE && !inference.read(statement)) {
+                // no C local, what is stored in the variable is only computed
+                discardValue(scope, value);
+                definition.pointer.clear();
+                definition.value = {CTV_NATIVE_VARIABLE, "", {}, native};
+                scope->variables[atom] = definition;
+                continue;
+            } else if (native != NATIVE_NONE) {
+                // a C local and its box, which is what goes when the scope ends
+                auto id = to_string(scope->id) + "_" + name;
+                definition.pointer = "_neo_box_" + id;
+                definition.value = {CTV_NATIVE_VARIABLE, (native == NATIVE_INT ? "_neo_int_" : "_neo_double_") + id,
+                                    {}, native, definition.pointer};
+                storeNative(scope, definition.value, std::move(value), true);
+                scope->variables[atom] = definition;
+                continue;
+            }
+            auto local = inference.storage(statement) == STORAGE_LOCAL;
+            if (!local) {
+                globalCode += "NeoObject *" + varId + ";\n";
             }
-        } else if (statement->type == S_VARIABLE_DECLARATION) {
-            unique_ptr<VariableDeclarationStatement> &st = (unique_ptr<VariableDeclarationStatement> &) statement;
-            if (scope->variables.find(st->name->value) != scope->variables.end()) {
-                st->name->throwError("SyntaxError: Variable '" + st->name->value + "' already defined");
+            // a temporary is handed over, anything else is shared, except the literals, which are immortal
+            auto shared = value.type != CTV_TEMP && value.type != CTV_CONSTANT;
+            value = materialize(scope, std::move(value));
+            if (shared && value.type != CTV_TEMP) {
+                scope->append("NEO_reference(" + value.pointer + ");\n");
             }
-            string varId = "_neo_var_" + to_string(scope->id) + "_" + st->name->value;
-            globalCode += "NeoObject *" + varId + ";\n";
-            auto value = executeExpression(scope, st->value);
-            scope->append(varId + " = " + value.pointer + ";\n");
-            scope->variables[st->name->value] = VariableDefinition(varId, st->constant, false);
-        } else if (statement->type == S_DO) {
-            unique_ptr<DoStatement> &st = (unique_ptr<DoStatement> &) statement;
+            scope->append((local ? "NeoObject *" : "") + varId + " = " + value.pointer + ";\n");
+            scope->variables[atom] = definition;
+        } else if (kind == S_DO) {
             auto newScope = new Scope(++_id, scope->fnCode, scope, scope->isLoop);
             newScope->indentStr = scope->indentStr;
-            compileScope(newScope, &st->body);
+            compileScope(newScope, ast.list(ast.lhs[statement]));
             delete newScope;
-        } else if (statement->type == S_IF_FLOW) {
-            unique_ptr<IfFlowStatement> &st = (unique_ptr<IfFlowStatement> &) statement;
-            auto condition = executeExpression(scope, st->condition);
-            scope->append("if (NEO_get_truthy(" + condition.pointer + ")) {\n");
+        } else if (kind == S_IF_FLOW) {
+            auto condition = foldExpression(scope, ast.lhs[statement]);
+            if (condition.type == CTV_NATIVE && condition.native == NATIVE_BOOL) {
+                scope->append("if (" + condition.pointer + ") {\n");
+            } else {
+                condition = materialize(scope, std::move(condition));
+                scope->append("if (NEO_get_truthy(" + condition.pointer + ")) {\n");
+            }
             auto newScope = new Scope(++_id, scope->fnCode, scope, scope->isLoop);
             newScope->indentStr = scope->indentStr + "\t";
-            compileScope(newScope, &st->body);
+            compileScope(newScope, ast.list(ast.rhs[statement]));
             delete newScope;
             scope->append("}");
-            if (st->elseBody.size() > 0) {
+            auto elseBody = ast.list(ast.rhs[statement] + 2);
+            if (elseBody.size() > 0) {
                 scope->append(" else {\n", false);
                 newScope = new Scope(++_id, scope->fnCode, scope, scope->isLoop);
                 newScope->indentStr = scope->indentStr + "\t";
-                compileScope(newScope, &st->elseBody);
+                compileScope(newScope, elseBody);
                 scope->append("}\n");
             } else scope->append("\n", false);
             if (condition.type == CTV_TEMP) {
                 scope->append("NEO_dereference(" + condition.pointer + ");\n");
             }
-        } else if (statement->type == S_FUNCTION_DECLARATION) {
-            unique_ptr<FunctionDeclarationStatement> &st = (unique_ptr<FunctionDeclarationStatement> &) statement;
-            if (scope->variables.find(st->name->value) != scope->variables.end()) {
-                st->name->throwError("SyntaxError: '" + st->name->value + "' is already defined");
+        } else if (kind == S_FUNCTION_DECLARATION) {
+            auto name = token->atom;
+            if (scope->variables.find(name) != scope->variables.end()) {
+                token->reportError("SyntaxError: '" + string(token->value) + "' is already defined");
             }
             vector<MissingFunctionDefinition> newMissing;
-            vector<size_t> indexes;
-            for (int i = missingFunctionDefinitions.size() - 1; i >= 0; --i) {
-                auto missing = missingFunctionDefinitions[i];
-                if (missing.functionName == st->name->value) {
-                    for (int j = missing.scopePoint.size() - 1; j >= 0; --j) {
-                        missing.scope->fnCode.insert(missing.scopePoint[j],
-                                                     "_neo_var_" + to_string(scope->id) + "_" + st->name->value);
-                    }
+            // what introduceFunction names the C function or the function object, see executeCall
+            auto pointer = (inference.reassigned(name) ? "_neo_var_" : "_neo_fn_") + to_string(scope->id) + "_" +
+                           string(token->value);
+            for (auto &missing: missingFunctionDefinitions) {
+                if (missing.functionName == name) {
+                    symbols[missing.symbol] = pointer;
                 } else {
-                    newMissing.insert(newMissing.begin(), missing);
+                    newMissing.push_back(missing);
                 }
             }
-            missingFunctionDefinitions.clear();
-            missingFunctionDefinitions = newMissing;
-            introduceFunction(scope, st->name->value, &st->body, false);
-        } else if (statement->type == S_RETURN) {
-            unique_ptr<ReturnStatement> &st = (unique_ptr<ReturnStatement> &) statement;
-            if (st->value.size() == 0) {
+            missingFunctionDefinitions = std::move(newMissing);
+            introduceFunction(scope, name, ast.list(ast.rhs[statement]), false);
+        } else if (kind == S_RETURN) {
+            if (ast.lhs[statement] == NO_NODE) {
                 scope->append("return NULL;\n");
             } else {
-                auto result = executeExpression(scope, st->value);
-                scope->returning = result;
+                auto result = executeExpression(scope, ast.lhs[statement]);
+                if (result.type == CTV_TEMP) {
+                    scope->returning = result;
+                } else {
+                    // the caller owns what a call returns, as it does a temporary
+                    scope->append("NEO_reference(" + result.pointer + ");\n");
+                }
                 scope->clearVariables();
                 scope->clearTemp();
                 scope->append("return " + result.pointer + ";\n");
             }
             return;
-        } else if (statement->type == S_BREAK) {
+        } else if (kind == S_BREAK) {
             scope->append("break;\n");
             return;
-        } else if (statement->type == S_CONTINUE) {
+        } else if (kind == S_CONTINUE) {
             scope->append("break;\n");
             return;
-        } else if (statement->type == S_LOOP) {
+        } else if (kind == S_LOOP) {
             scope->append("while(1) {\n");
             auto newScope = new Scope(++_id, scope->fnCode, scope, true);
             newScope->indentStr = scope->indentStr + "\t";
-            compileScope(newScope, &((unique_ptr<LoopStatement> &) statement)->body);
+            compileScope(newScope, ast.list(ast.lhs[statement]));
             scope->append("}\n");
             return;
         } else {
-            cout << "Unhandled statement: " << statement->type << endl;
+            cout << "Unhandled statement: " << (int) kind << endl;
             exit(1);
         }
     }
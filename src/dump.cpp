@@ -0,0 +1,423 @@
+#include "dump.hpp"
+
+using namespace std;
+
+static const char spaces[] = "                                                                ";
+
+JsonWriter::~JsonWriter() {
+    flush();
+}
+
+void JsonWriter::flush() {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+void JsonWriter::done() {
+    // a whole value is out, or the buffer is big enough to hand over
+    if (depth == 0 || buffer.size() >= 1 << 16) {
+        flush();
+    }
+}
+
+void JsonWriter::newline() {
+    put('\n');
+    for (auto indent = 2 * depth; indent > 0;) {
+        auto n = min(indent, sizeof(spaces) - 1);
+        write(spaces, n);
+        indent -= n;
+    }
+}
+
+void JsonWriter::element() {
+    if (keyed) {
+        keyed = false;
+        return;
+    }
+    if (depth == 0) {
+        return;
+    }
+    if (!empty) {
+        put(',');
+    }
+    if (depth < compactDepth) {
+        newline();
+    } else if (!empty) {
+        put(' ');
+    }
+    empty = false;
+}
+
+void JsonWriter::open(char bracket, bool compact) {
+    element();
+    put(bracket);
+    depth++;
+    if (compact && compactDepth == SIZE_MAX) {
+        compactDepth = depth;
+    }
+    empty = true;
+}
+
+void JsonWriter::close(char bracket) {
+    depth--;
+    if (depth + 1 == compactDepth) {
+        compactDepth = SIZE_MAX;
+    } else if (!empty && depth < compactDepth) {
+        // lined up with the opening bracket
+        newline();
+    }
+    put(bracket);
+    empty = false;
+    done();
+}
+
+void JsonWriter::key(string_view name) {
+    element();
+    quoted(name);
+    write(": ", 2);
+    keyed = true;
+}
+
+void JsonWriter::value(string_view text) {
+    element();
+    quoted(text);
+    done();
+}
+
+void JsonWriter::value(bool flag) {
+    element();
+    if (flag) {
+        write("true", 4);
+    } else {
+        write("false", 5);
+    }
+    done();
+}
+
+void JsonWriter::value(uint64_t number) {
+    element();
+    auto text = to_string(number);
+    write(text.data(), text.size());
+    done();
+}
+
+void JsonWriter::null() {
+    element();
+    write("null", 4);
+    done();
+}
+
+void JsonWriter::quoted(string_view text) {
+    // runs of characters that need no escape are written at once
+    static const char hex[] = "0123456789abcdef";
+    put('"');
+    size_t run = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        auto chr = (unsigned char) text[i];
+        if (chr >= 0x20 && chr != '"' && chr != '\\') {
+            continue;
+        }
+        write(text.data() + run, i - run);
+        run = i + 1;
+        switch (chr) {
+            case '"':
+                write("\\\"", 2);
+                break;
+            case '\\':
+                write("\\\\", 2);
+                break;
+            case '\n':
+                write("\\n", 2);
+                break;
+            case '\r':
+                write("\\r", 2);
+                break;
+            case '\t':
+                write("\\t", 2);
+                break;
+            default:
+                char escape[] = {'\\', 'u', '0', '0', hex[chr >> 4], hex[chr & 15]};
+                write(escape, sizeof(escape));
+        }
+    }
+    write(text.data() + run, text.size() - run);
+    put('"');
+}
+
+void writeToken(JsonWriter &json, const Token *token) {
+    if (token->type == T_GROUP) {
+        json.beginObject();
+        json.key("type");
+        json.value(tokenTypeName(T_GROUP));
+        json.key("children");
+        writeTokens(json, token->children);
+        json.endObject();
+        return;
+    }
+    json.beginObject(true);
+    json.key("type");
+    json.value(tokenTypeName(token->type));
+    json.key("value");
+    json.value(token->value);
+    json.endObject();
+}
+
+void writeTokens(JsonWriter &json, TokenList tokens) {
+    json.beginArray();
+    for (auto token: tokens) {
+        writeToken(json, token);
+    }
+    json.endArray();
+}
+
+static void writeOptional(JsonWriter &json, const Ast &ast, NodeId node) {
+    if (node == NO_NODE) {
+        json.null();
+    } else {
+        writeNode(json, ast, node);
+    }
+}
+
+void writeNodes(JsonWriter &json, const Ast &ast, NodeList nodes) {
+    json.beginArray();
+    for (auto node: nodes) {
+        writeOptional(json, ast, node);
+    }
+    json.endArray();
+}
+
+void writeNode(JsonWriter &json, const Ast &ast, NodeId node) {
+    auto token = ast.tokens[node];
+    auto left = ast.lhs[node];
+    auto right = ast.rhs[node];
+    auto kind = ast.kinds[node];
+    // statements take a line each, an expression is kept on the line of its statement
+    json.beginObject(!IsStatementNode(kind) || kind == S_BREAK || kind == S_CONTINUE);
+    switch (kind) {
+        case S_VARIABLE_DECLARATION:
+            json.key("type");
+            json.value("variable declaration");
+            json.key("identifier");
+            writeToken(json, token);
+            json.key("value");
+            writeOptional(json, ast, left);
+            json.key("constant");
+            json.value((ast.flags[node] & F_CONSTANT) != 0);
+            break;
+        case S_FUNCTION_DECLARATION:
+            json.key("type");
+            json.value("function declaration");
+            json.key("name");
+            json.value(token->value);
+            json.key("arguments");
+            json.beginArray();
+            for (uint32_t i = 0; i < ast.extra[left]; i++) {
+                writeTokens(json, ast.tokenList(ast.extra[left + 1 + 2 * i], ast.extra[left + 2 + 2 * i]));
+            }
+            json.endArray();
+            json.key("body");
+            writeNodes(json, ast, ast.list(right));
+            break;
+        case S_DO:
+        case S_LOOP:
+            json.key("type");
+            json.value(kind == S_DO ? "do" : "loop");
+            json.key("body");
+            writeNodes(json, ast, ast.list(left));
+            break;
+        case S_WHILE:
+        case S_DO_WHILE:
+            json.key("type");
+            json.value(kind == S_WHILE ? "while" : "do while");
+            json.key("condition");
+            writeOptional(json, ast, left);
+            json.key("body");
+            writeNodes(json, ast, ast.list(right));
+            break;
+        case S_FOR_ITERATOR:
+            json.key("type");
+            json.value("for iterator");
+            json.key("index");
+            writeToken(json, token);
+            json.key("value");
+            writeToken(json, ast.tokenLists[ast.extra[right + 2]]);
+            json.key("iterator");
+            writeOptional(json, ast, left);
+            json.key("body");
+            writeNodes(json, ast, ast.list(right));
+            break;
+        case S_FOR_CLASSIC:
+            json.key("type");
+            json.value("for classic");
+            json.key("init");
+            writeNode(json, ast, ast.extra[right + 2]);
+            json.key("condition");
+            writeOptional(json, ast, left);
+            json.key("iterator");
+            writeNode(json, ast, ast.extra[right + 3]);
+            json.key("body");
+            writeNodes(json, ast, ast.list(right));
+            break;
+        case S_RETURN:
+            json.key("type");
+            json.value("return");
+            json.key("expression");
+            writeOptional(json, ast, left);
+            break;
+        case S_BREAK:
+        case S_CONTINUE:
+            json.key("type");
+            json.value(kind == S_BREAK ? "break" : "continue");
+            break;
+        case S_CLASS_DEFINITION:
+            json.key("type");
+            json.value("class definition");
+            json.key("attributes");
+            writeNodes(json, ast, ast.list(left));
+            json.key("methods");
+            writeNodes(json, ast, ast.list(right));
+            break;
+        case S_IF_FLOW:
+            json.key("type");
+            json.value("if flow");
+            json.key("condition");
+            writeOptional(json, ast, left);
+            json.key("body");
+            writeNodes(json, ast, ast.list(right));
+            json.key("elseBody");
+            writeNodes(json, ast, ast.list(right + 2));
+            break;
+        case S_IMPORT:
+            json.key("type");
+            json.value("import");
+            json.key("name");
+            writeToken(json, token);
+            json.key("imports");
+            writeTokens(json, ast.tokenList(ast.extra[left], ast.extra[left + 1]));
+            break;
+        case S_EXPRESSION:
+            json.key("type");
+            json.value("expression");
+            json.key("expression");
+            writeOptional(json, ast, left);
+            break;
+        case E_LITERAL:
+            // the source text, strings with their quotes
+            json.key("type");
+            json.value("literal");
+            json.key("kind");
+            json.value(tokenTypeName(token->type));
+            json.key("value");
+            json.value(token->value);
+            break;
+        case E_IDENTIFIER:
+            json.key("type");
+            json.value("identifier");
+            json.key("name");
+            json.value(token->value);
+            break;
+        case E_ARRAY:
+            json.key("type");
+            json.value("array");
+            if (ast.flags[node] & F_PATTERN) {
+                json.key("pattern");
+                json.value(true);
+            }
+            json.key("elements");
+            writeNodes(json, ast, ast.list(left));
+            break;
+        case E_OBJECT:
+            json.key("type");
+            json.value("object");
+            if (ast.flags[node] & F_PATTERN) {
+                json.key("pattern");
+                json.value(true);
+            }
+            json.key("properties");
+            writeNodes(json, ast, ast.list(left));
+            break;
+        case E_PROPERTY:
+            json.key("key");
+            if (left != NO_NODE) {
+                writeNode(json, ast, left);
+            } else {
+                json.value(token->value);
+            }
+            json.key("value");
+            writeOptional(json, ast, right);
+            break;
+        case E_UNARY:
+            json.key("type");
+            json.value("unary");
+            json.key("operator");
+            json.value(token->value);
+            json.key("operand");
+            writeOptional(json, ast, left);
+            break;
+        case E_BINARY:
+            json.key("type");
+            json.value("binary");
+            json.key("operator");
+            json.value(token->value);
+            json.key("left");
+            writeOptional(json, ast, left);
+            json.key("right");
+            writeOptional(json, ast, right);
+            break;
+        case E_ASSIGNMENT:
+            json.key("type");
+            json.value("assignment");
+            json.key("operator");
+            json.value(token->value);
+            json.key("target");
+            writeOptional(json, ast, left);
+            json.key("value");
+            writeOptional(json, ast, right);
+            break;
+        case E_UPDATE:
+            json.key("type");
+            json.value("update");
+            json.key("operator");
+            json.value(token->value);
+            json.key("prefix");
+            json.value((ast.flags[node] & F_PREFIX) != 0);
+            json.key("target");
+            writeOptional(json, ast, left);
+            break;
+        case E_MEMBER:
+            json.key("type");
+            json.value("member");
+            json.key("object");
+            writeOptional(json, ast, left);
+            json.key("name");
+            json.value(token->value);
+            break;
+        case E_INDEX:
+            json.key("type");
+            json.value("index");
+            json.key("object");
+            writeOptional(json, ast, left);
+            json.key("key");
+            writeOptional(json, ast, right);
+            break;
+        case E_CALL:
+            json.key("type");
+            json.value("call");
+            json.key("callee");
+            writeOptional(json, ast, left);
+            json.key("arguments");
+            writeNodes(json, ast, ast.list(right));
+            break;
+        case E_KEYWORD_ARGUMENT:
+            json.key("keyword");
+            json.value(token->value);
+            json.key("value");
+            writeOptional(json, ast, left);
+            break;
+        default:
+            json.key("type");
+            json.value("unknown");
+            break;
+    }
+    json.endObject();
+}
@@ -1,44 +1,72 @@
 #include "error.hpp"
 #include <string>
 #include <iostream>
-#include <vector>
-#include <sstream>
+#include <algorithm>
 
-void showCodeSnippet(const string &color, const string &filename, const string &code, size_t index) {
-    vector<string> lines;
-    stringstream ss(code);
-    string line;
+Diagnostics diagnostics;
+thread_local bool raiseErrors = false;
 
-    while (getline(ss, line)) {
-        lines.push_back(line);
+void showCodeSnippet(const string &color, const Source *source, size_t index) {
+    size_t lineNumber, column;
+    source->location(index, lineNumber, column);
+    auto line = source->line(lineNumber);
+    size_t ind = column - 1;
+    cout << color << "Error on file " << source->filename << ", line " << lineNumber << ", column "
+         << column << ":" << RESET << endl;
+    cout << "    " << ITALIC << line.substr(0, ind) << (ind >= line.size() ? ' ' : line[ind])
+         << (ind >= line.size() ? " " : line.substr(ind + 1)) << RESET << endl;
+    for (size_t j = 0; j < ind + 4; ++j) {
+        cout << " ";
     }
+}
 
-    size_t charCount = 0;
-    for (size_t i = 0; i < lines.size(); ++i) {
-        size_t oldCharCount = charCount;
-        charCount += lines[i].size() + 1;
-        if (index >= oldCharCount && index < charCount) {
-            line = lines[i];
-            size_t ind = index - oldCharCount;
-            cout << color << "Error on file " << filename << ", line " << (i + 1) << ", column "
-                 << (ind + 1) << ":" << RESET << endl;
-            cout << "    " << ITALIC << line.substr(0, ind) << (ind >= line.size() ? ' ' : line[ind])
-                 << (ind >= line.size() ? " " : line.substr(ind + 1)) << RESET << endl;
-            for (size_t j = 0; j < ind + 4; ++j) {
-                cout << " ";
-            }
-            return;
-        }
+void showError(const string &message, const Source *source, size_t index) {
+    showCodeSnippet(RED, source, index);
+    cout << YELLOW << "^ " << message << endl;
+}
+
+void throwError(const string &message, const Source *source, size_t index) {
+    diagnostics.report(message, source, index);
+    if (raiseErrors) {
+        throw ErrorRaised();
     }
-    return;
+    diagnostics.exitOnErrors();
 }
 
-void showError(const string &message, const string &filename, const string &code, size_t index) {
-    showCodeSnippet(RED, filename, code, index);
-    cout << YELLOW << "^ " << message << endl;
+void reportError(const string &message, const Source *source, size_t index) {
+    diagnostics.report(message, source, index);
+}
+
+void Diagnostics::report(const string &message, const Source *source, size_t index) {
+    lock_guard<mutex> guard(lock);
+    pending.push_back({message, source, index});
 }
 
-void throwError(const string &message, const string &filename, const string &code, size_t index) {
-    showError(message, filename, code, index);
-    exit(1);
-}
\ No newline at end of file
+bool Diagnostics::hasErrors() {
+    lock_guard<mutex> guard(lock);
+    return !pending.empty();
+}
+
+void Diagnostics::flush() {
+    lock_guard<mutex> guard(lock);
+    stable_sort(pending.begin(), pending.end(), [](const Diagnostic &a, const Diagnostic &b) {
+        if (a.source != b.source) {
+            return a.source->filename < b.source->filename;
+        }
+        return a.index < b.index;
+    });
+    for (auto &diagnostic: pending) {
+        showError(diagnostic.message, diagnostic.source, diagnostic.index);
+    }
+    if (pending.size() > 1) {
+        cout << RED << pending.size() << " errors" << RESET << endl;
+    }
+    pending.clear();
+}
+
+void Diagnostics::exitOnErrors() {
+    if (hasErrors()) {
+        flush();
+        exit(1);
+    }
+}
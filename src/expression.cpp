@@ -0,0 +1,289 @@
+#include "expression.hpp"
+
+using namespace std;
+
+int operatorPrecedence(string_view op) {
+    if (op == "**") {
+        return 4;
+    }
+    if (op == "*" || op == "/" || op == "%") {
+        return 3;
+    }
+    if (op == "+" || op == "-") {
+        return 2;
+    }
+    if (op == "==" || op == "!=" || op == ">" || op == "<" || op == ">=" || op == "<=") {
+        return 1;
+    }
+    // || && and the bitwise operators
+    return 0;
+}
+
+bool isAssignmentOperator(const Token *token) {
+    return token->type == T_SET_OPERATOR || (token->type == T_OPERATOR && token->value == "=");
+}
+
+static bool isUnaryOperator(string_view op) {
+    return op == "!" || op == "~" || op == "-" || op == "+";
+}
+
+static bool isAssignable(const Ast &ast, NodeId expression) {
+    auto kind = ast.kinds[expression];
+    return kind == E_IDENTIFIER || kind == E_MEMBER || kind == E_INDEX;
+}
+
+static vector<TokenList> splitList(TokenList tokens, string_view delim) {
+    // like splitTokens with emptyError, but the parts are views of tokens
+    vector<TokenList> result;
+    size_t start = 0;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (tokens[i]->value != delim) {
+            continue;
+        }
+        if (i == start) {
+            tokens[i]->throwError("SyntaxError: Unexpected token '" + string(tokens[i]->value) + "'");
+        }
+        result.emplace_back(tokens.items + start, i - start);
+        start = i + 1;
+    }
+    if (start < tokens.size()) {
+        result.emplace_back(tokens.items + start, tokens.size() - start);
+    }
+    return result;
+}
+
+NodeId parseExpression(Ast &ast, TokenList tokens) {
+    return ExpressionParser(ast, tokens).parse();
+}
+
+Token *ExpressionParser::peek() const {
+    return index < tokens.size() ? tokens[index] : nullptr;
+}
+
+NodeId ExpressionParser::parse() {
+    if (tokens.empty()) {
+        return NO_NODE;
+    }
+    auto expression = parseAssignment();
+    if (index < tokens.size()) {
+        tokens[index]->throwError("SyntaxError: Unexpected token '" + string(tokens[index]->value) + "'");
+    }
+    return expression;
+}
+
+NodeId ExpressionParser::parseAssignment() {
+    // an array or an object right before = is a pattern rather than a value
+    auto first = peek();
+    auto following = index + 1 < tokens.size() ? tokens[index + 1] : nullptr;
+    auto pattern = first->type == T_GROUP && first->value[0] != '(' && following != nullptr &&
+                   isAssignmentOperator(following);
+    auto target = pattern ? parsePattern(tokens[index++]) : parseBinary(0);
+    auto op = peek();
+    if (op == nullptr || !isAssignmentOperator(op)) {
+        return target;
+    }
+    if (op->value == ":=") {
+        op->throwError("SyntaxError: Cannot use ':=' inside expressions");
+    }
+    if (pattern ? op->value != "=" : !isAssignable(ast, target)) {
+        op->throwError("SyntaxError: Invalid assignment target");
+    }
+    ++index;
+    if (peek() == nullptr) {
+        op->throwError("SyntaxError: Expected an expression");
+    }
+    auto value = parseAssignment();
+    return ast.add(E_ASSIGNMENT, op, target, value);
+}
+
+NodeId ExpressionParser::parseBinary(int minPrecedence) {
+    auto left = parseUnary();
+    Token *op;
+    while ((op = peek()) != nullptr && IsAnyOperatorToken(op) && !isAssignmentOperator(op)) {
+        auto precedence = operatorPrecedence(op->value);
+        if (precedence < minPrecedence) {
+            break;
+        }
+        ++index;
+        auto right = parseBinary(op->value == "**" ? precedence : precedence + 1);
+        left = ast.add(E_BINARY, op, left, right);
+    }
+    return left;
+}
+
+NodeId ExpressionParser::parseUnary() {
+    auto token = peek();
+    if (token == nullptr) {
+        tokens[index - 1]->throwError("SyntaxError: Expected expression after operator");
+    }
+    if (token->type == T_INC_OPERATOR) {
+        ++index;
+        if (peek() == nullptr) {
+            token->throwError("SyntaxError: Expected expression after operator");
+        }
+        return parseUpdate(token, parsePostfix(parsePrimary()), true);
+    }
+    if (IsAnyOperatorToken(token)) {
+        if (!isUnaryOperator(token->value)) {
+            token->throwError("SyntaxError: Unexpected token '" + string(token->value) + "'");
+        }
+        ++index;
+        return ast.add(E_UNARY, token, parseUnary());
+    }
+    auto expression = parsePostfix(parsePrimary());
+    if (peek() != nullptr && peek()->type == T_INC_OPERATOR) {
+        return parseUpdate(tokens[index++], expression, false);
+    }
+    return expression;
+}
+
+NodeId ExpressionParser::parseUpdate(Token *op, NodeId target, bool prefix) {
+    if (!isAssignable(ast, target)) {
+        op->throwError("SyntaxError: Invalid " + string(prefix ? "prefix" : "postfix") + " operation target");
+    }
+    return ast.add(E_UPDATE, op, target, NO_NODE, prefix ? F_PREFIX : 0);
+}
+
+NodeId ExpressionParser::parsePostfix(NodeId expression) {
+    Token *token;
+    while ((token = peek()) != nullptr && !IsAnyOperatorToken(token)) {
+        if (token->type == T_SYMBOL && token->value == ".") {
+            // a.b is the same as a b, the dot has to be followed by something
+            auto following = index + 1 < tokens.size() ? tokens[index + 1] : nullptr;
+            if (tokens[index - 1]->value == "." || following == nullptr || IsAnyOperatorToken(following)) {
+                token->throwError("SyntaxError: Unexpected '.'");
+            }
+            ++index;
+            continue;
+        }
+        ++index;
+        if (token->type == T_IDENTIFIER) {
+            expression = ast.add(E_MEMBER, token, expression);
+        } else if (token->type == T_GROUP && token->value[0] == '(') {
+            expression = ast.add(E_CALL, token, expression, parseArguments(token));
+        } else if (token->type == T_GROUP && token->value[0] == '[') {
+            if (token->children.empty()) {
+                token->throwError("SyntaxError: Expected expression");
+            }
+            expression = ast.add(E_INDEX, token, expression, parseExpression(ast, token->children));
+        } else {
+            token->throwError("SyntaxError: Unexpected token '" + string(token->value) + "'");
+        }
+    }
+    return expression;
+}
+
+NodeId ExpressionParser::parsePrimary() {
+    auto token = tokens[index++];
+    if (token->type == T_NUMBER || token->type == T_STRING) {
+        return ast.add(E_LITERAL, token);
+    }
+    if (token->type == T_IDENTIFIER) {
+        return ast.add(E_IDENTIFIER, token);
+    }
+    if (token->type == T_GROUP) {
+        if (token->value[0] == '(') {
+            if (token->children.empty()) {
+                token->throwError("SyntaxError: Expected expression inside parenthesis");
+            }
+            return parseExpression(ast, token->children);
+        }
+        if (token->value[0] == '[') {
+            return parseArray(token);
+        }
+        return parseObject(token);
+    }
+    token->throwError("SyntaxError: Unexpected token '" + string(token->value) + "'");
+    return NO_NODE;
+}
+
+NodeId ExpressionParser::parseArray(Token *group) {
+    auto mark = ast.beginList();
+    for (auto element: splitList(group->children, ",")) {
+        auto node = parseExpression(ast, element);
+        ast.scratch.push_back(node);
+    }
+    auto slot = ast.reserve(2);
+    ast.endList(mark, slot);
+    return ast.add(E_ARRAY, group, slot);
+}
+
+NodeId ExpressionParser::parseObject(Token *group) {
+    auto mark = ast.beginList();
+    for (auto property: splitList(group->children, ",")) {
+        auto kv = splitList(property, ":");
+        if (kv.size() != 2) {
+            kv[0][0]->throwError("SyntaxError: Invalid key-value pair.");
+        }
+        if (kv[0].size() != 1) {
+            kv[0][0]->throwError("SyntaxError: Invalid object key.");
+        }
+        auto key = kv[0][0];
+        NodeId computedKey = NO_NODE;
+        if (key->type == T_GROUP && key->value[0] == '[') {
+            computedKey = parseExpression(ast, key->children);
+        } else if (key->type != T_IDENTIFIER && key->type != T_STRING) {
+            key->throwError("SyntaxError: Invalid object key.");
+        }
+        auto value = parseExpression(ast, kv[1]);
+        ast.scratch.push_back(ast.add(E_PROPERTY, key, computedKey, value));
+    }
+    auto slot = ast.reserve(2);
+    ast.endList(mark, slot);
+    return ast.add(E_OBJECT, group, slot);
+}
+
+NodeId ExpressionParser::parsePattern(Token *group) {
+    auto object = group->value[0] == '{';
+    auto mark = ast.beginList();
+    for (auto element: splitList(group->children, ",")) {
+        if (!object) {
+            auto target = parseTarget(element);
+            ast.scratch.push_back(target);
+            continue;
+        }
+        // {a} is {a: a}
+        auto kv = splitList(element, ":");
+        auto key = kv[0][0];
+        if (element[element.size() - 1]->value == ":") {
+            // splitList drops the empty value of {a:}, which is not {a}
+            key->throwError("SyntaxError: Invalid key-value pair.");
+        }
+        if (kv.size() > 2 || kv[0].size() != 1 || (key->type != T_IDENTIFIER && key->type != T_STRING) ||
+            (kv.size() == 1 && key->type != T_IDENTIFIER)) {
+            key->throwError("SyntaxError: Invalid object key.");
+        }
+        auto target = kv.size() == 2 ? parseTarget(kv[1]) : ast.add(E_IDENTIFIER, key);
+        ast.scratch.push_back(ast.add(E_PROPERTY, key, NO_NODE, target));
+    }
+    auto slot = ast.reserve(2);
+    ast.endList(mark, slot);
+    return ast.add(object ? E_OBJECT : E_ARRAY, group, slot, NO_NODE, F_PATTERN);
+}
+
+NodeId ExpressionParser::parseTarget(TokenList tokens) {
+    if (tokens.size() == 1 && tokens[0]->type == T_GROUP && tokens[0]->value[0] != '(') {
+        return parsePattern(tokens[0]);
+    }
+    auto target = parseExpression(ast, tokens);
+    if (!isAssignable(ast, target)) {
+        tokens[0]->throwError("SyntaxError: Invalid assignment target");
+    }
+    return target;
+}
+
+uint32_t ExpressionParser::parseArguments(Token *group) {
+    auto mark = ast.beginList();
+    for (auto argument: splitList(group->children, ",")) {
+        if (argument.size() > 2 && argument[0]->type == T_IDENTIFIER && argument[1]->value == ":") {
+            auto value = parseExpression(ast, TokenList(argument.items + 2, argument.size() - 2));
+            ast.scratch.push_back(ast.add(E_KEYWORD_ARGUMENT, argument[0], value));
+        } else {
+            auto value = parseExpression(ast, argument);
+            ast.scratch.push_back(value);
+        }
+    }
+    auto slot = ast.reserve(2);
+    ast.endList(mark, slot);
+    return slot;
+}
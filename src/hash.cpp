@@ -0,0 +1,74 @@
+#include "hash.hpp"
+#include <cstring>
+
+static inline uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed) {
+    auto p = (const unsigned char *) data;
+    // two independent lanes so the multiplies overlap
+    uint64_t a = seed ^ 0x9e3779b97f4a7c15ull;
+    uint64_t b = (seed + size) ^ 0x632be59bd9b4e019ull;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint64_t x, y;
+        memcpy(&x, p + i, 8);
+        memcpy(&y, p + i + 8, 8);
+        a = (a ^ x) * 0x87c37b91114253d5ull;
+        b = (b ^ y) * 0x4cf5ad432745937full;
+        a = (a << 31) | (a >> 33);
+        b = (b << 29) | (b >> 35);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, size - i < 8 ? size - i : 8);
+    a ^= tail;
+    if (size - i > 8) {
+        tail = 0;
+        memcpy(&tail, p + i + 8, size - i - 8);
+        b ^= tail;
+    }
+    return mix(a ^ mix(b ^ size));
+}
+
+string hashToString(uint64_t hash) {
+    static const char digits[] = "0123456789abcdef";
+    string result(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        result[i] = digits[hash & 15];
+        hash >>= 4;
+    }
+    return result;
+}
+
+int HashingBuffer::sync() {
+    auto size = pptr() - pbase();
+    state = hashBytes(pbase(), size, state);
+    auto written = target->sputn(pbase(), size);
+    setp(block, block + sizeof(block));
+    if (written != size) {
+        return -1;
+    }
+    return target->pubsync();
+}
+
+int HashingBuffer::overflow(int chr) {
+    if (sync() != 0) {
+        return traits_type::eof();
+    }
+    if (chr != traits_type::eof()) {
+        *pptr() = (char) chr;
+        pbump(1);
+    }
+    return traits_type::not_eof(chr);
+}
+
+uint64_t HashingBuffer::hash() {
+    sync();
+    return state;
+}
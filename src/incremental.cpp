@@ -0,0 +1,185 @@
+#include "incremental.hpp"
+#include <algorithm>
+#include <cstring>
+
+Document::Document(shared_ptr<Source> source, Arena *arena) : parser(Lexer(source, arena)), arena(arena) {
+    build(std::move(source));
+}
+
+void Document::build(shared_ptr<Source> source) {
+    parser.ast.clear();
+    parser.blocks.clear();
+    arena->reset();
+    for (auto &old: history) {
+        old->edited = nullptr;
+    }
+    history.clear();
+    historySize = 0;
+    parser = Parser(Lexer(std::move(source), arena));
+    parser.lexer.tokenize();
+    parser.lexer.groupTokens();
+    parser.parse();
+    builtSize = arena->used();
+    builtNodes = parser.ast.size();
+}
+
+static size_t commonPrefix(const char *a, const char *b, size_t n) {
+    // a block at a time first, memcmp is a lot faster than comparing bytes
+    size_t i = 0;
+    while (i + 4096 <= n && memcmp(a + i, b + i, 4096) == 0) {
+        i += 4096;
+    }
+    while (i < n && a[i] == b[i]) {
+        ++i;
+    }
+    return i;
+}
+
+static size_t commonSuffix(const char *a, const char *b, size_t n) {
+    // a and b point right after the last byte
+    size_t i = 0;
+    while (i + 4096 <= n && memcmp(a - i - 4096, b - i - 4096, 4096) == 0) {
+        i += 4096;
+    }
+    while (i < n && a[-1 - (ptrdiff_t) i] == b[-1 - (ptrdiff_t) i]) {
+        ++i;
+    }
+    return i;
+}
+
+bool Document::update(shared_ptr<Source> source) {
+    auto a = parser.lexer.source->code;
+    auto b = source->code;
+    auto limit = min(a.size(), b.size());
+    auto prefix = commonPrefix(a.data(), b.data(), limit);
+    auto suffix = commonSuffix(a.data() + a.size(), b.data() + b.size(), limit - prefix);
+    if (prefix == a.size() && a.size() == b.size()) {
+        return true;
+    }
+    return update(std::move(source), prefix, a.size() - suffix, b.size() - suffix);
+}
+
+static bool balanced(const vector<Token *> &stream) {
+    vector<char> open;
+    for (auto token: stream) {
+        if (token->type != T_PAREN) {
+            continue;
+        }
+        auto chr = token->value[0];
+        if (chr == '(' || chr == '[' || chr == '{') {
+            open.push_back(chr);
+        } else if (open.empty() || closingParen(open.back()) != chr) {
+            return false;
+        } else {
+            open.pop_back();
+        }
+    }
+    return open.empty();
+}
+
+static size_t position(const Token *token) {
+    // where the token starts in the current source
+    auto at = token->start;
+    token->source->forward(at);
+    return at;
+}
+
+bool Document::update(shared_ptr<Source> source, size_t start, size_t oldEnd, size_t newEnd) {
+    // every edit leaves the tokens and nodes it replaced behind, start over once they add up
+    auto garbage = arena->used() > 2 * builtSize + 1024 * 1024 || parser.ast.size() > 2 * builtNodes + 64 * 1024;
+    auto group = garbage ? nullptr : findGroup(start, oldEnd);
+    if (group == nullptr) {
+        build(std::move(source));
+        return false;
+    }
+
+    // The lexer is at the start of a token right after the '{' and the code before it didn't change, so lexing the
+    // inside of the group on its own gives the same tokens as lexing the whole file, as long as it stops right at
+    // the '}' and the parentheses inside still match.
+    auto delta = (ptrdiff_t) newEnd - (ptrdiff_t) oldEnd;
+    auto groupStart = position(group);
+    auto close = groupStart + (group->end - group->start) - 1 + delta;
+    auto lexer = Lexer(source, arena);
+    if (lexer.tokenizeRange(groupStart + 1, close) != close || !balanced(lexer.stream)) {
+        build(std::move(source));
+        return false;
+    }
+
+    // the innermost block around the group is parsed again, its old nested blocks go away with its statements
+    auto block = group;
+    while (block != nullptr && parser.blocks.find(block) == parser.blocks.end()) {
+        block = block->parent;
+    }
+    if (block != nullptr) {
+        parser.forgetBlocks(block->children);
+    }
+
+    // tokens after the edit move lazily through the old source, only the groups around it change here
+    auto old = parser.lexer.source;
+    old->edited = source.get();
+    old->editEnd = oldEnd;
+    old->editDelta = delta;
+    history.push_back(old);
+    historySize += old->code.size();
+    for (auto token = group; token != nullptr; token = token->parent) {
+        auto length = token->end - token->start + delta;
+        token->start = position(token);
+        token->end = token->start + length;
+        token->source = source.get();
+        token->updateValue();
+    }
+    group->children = lexer.groupStream(lexer.stream.data(), lexer.stream.size(), group);
+    parser.lexer.source = source;
+    parser.lexer.code = source->code;
+    if (historySize > 4 * source->code.size() + 16 * 1024 * 1024) {
+        rebase(parser.lexer.tokens);
+        rebase(TokenList(&parser.lexer.eof, 1));
+        for (auto &s: history) {
+            s->edited = nullptr;
+        }
+        history.clear();
+        historySize = 0;
+    }
+
+    if (block == nullptr) {
+        parser.parse();
+        return true;
+    }
+    parser.parseBlock(block, block->children, parser.blocks[block]);
+    return true;
+}
+
+Token *Document::findGroup(size_t start, size_t end) const {
+    // the innermost {} group whose inside holds the whole edit
+    Token *found = nullptr;
+    auto tokens = parser.lexer.tokens;
+    while (true) {
+        auto it = partition_point(tokens.begin(), tokens.end(), [&](Token *t) { return position(t) < start; });
+        if (it == tokens.begin()) {
+            return found;
+        }
+        auto token = *(it - 1);
+        if (token->type != T_GROUP || position(token) + (token->end - token->start) - 1 < end) {
+            return found;
+        }
+        if (token->value[0] == '{') {
+            found = token;
+        }
+        tokens = token->children;
+    }
+}
+
+void Document::rebase(TokenList tokens) {
+    // points every token at the current source, so the older ones can go
+    auto source = parser.lexer.source.get();
+    for (auto token: tokens) {
+        auto length = token->end - token->start;
+        token->start = position(token);
+        token->end = token->start + length;
+        token->source = source;
+        token->updateValue();
+        if (token->type == T_GROUP) {
+            rebase(token->children);
+        }
+    }
+}
@@ -0,0 +1,348 @@
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include "inference.hpp"
+
+using namespace std;
+
+NativeType literalType(const Token *token) {
+    // as Compiler::executeLiteral folds them
+    string text(token->value);
+    if (token->type == T_STRING || text.find('n') != string::npos) {
+        return NATIVE_NONE;
+    }
+    char *end;
+    if (text.find('.') == string::npos && text.find('e') == string::npos) {
+        errno = 0;
+        auto integer = strtoll(text.c_str(), &end, 0);
+        auto fits = *end == '\0' && errno == 0 && integer >= INT32_MIN && integer <= INT32_MAX;
+        return fits ? NATIVE_INT : NATIVE_NONE;
+    }
+    auto number = strtod(text.c_str(), &end);
+    return *end == '\0' && isfinite(number) ? NATIVE_DOUBLE : NATIVE_NONE;
+}
+
+NativeType binaryType(string_view op, NativeType a, NativeType b) {
+    if (a == NATIVE_NONE || a == NATIVE_BOOL || b == NATIVE_NONE || b == NATIVE_BOOL) {
+        return NATIVE_NONE;
+    }
+    if (a == NATIVE_UNKNOWN || b == NATIVE_UNKNOWN) {
+        return NATIVE_UNKNOWN;
+    }
+    if (op == "<" || op == ">" || op == "<=" || op == ">=" || op == "==" || op == "!=") {
+        return NATIVE_BOOL;
+    }
+    if (a == NATIVE_INT && b == NATIVE_INT) {
+        // int / int is a double
+        return op == "+" || op == "-" || op == "*" || op == "%" ? NATIVE_INT :
+               op == "/" ? NATIVE_DOUBLE : NATIVE_NONE;
+    }
+    return op == "+" || op == "-" || op == "*" || op == "/" ? NATIVE_DOUBLE : NATIVE_NONE;
+}
+
+// Calls visit on the nodes a node holds, statements and expressions alike.
+template<typename Visit>
+static void forChildren(const Ast &ast, NodeId node, Visit visit) {
+    auto left = ast.lhs[node];
+    auto right = ast.rhs[node];
+    auto visitList = [&](uint32_t slot) {
+        for (auto child: ast.list(slot)) {
+            visit(child);
+        }
+    };
+    switch (ast.kinds[node]) {
+        case S_FUNCTION_DECLARATION:
+            visitList(right);
+            break;
+        case S_DO:
+        case S_LOOP:
+        case E_ARRAY:
+        case E_OBJECT:
+            visitList(left);
+            break;
+        case S_WHILE:
+        case S_DO_WHILE:
+        case S_FOR_ITERATOR:
+            visit(left);
+            visitList(right);
+            break;
+        case S_FOR_CLASSIC:
+            visit(left);
+            visitList(right);
+            visit(ast.extra[right + 2]);
+            visit(ast.extra[right + 3]);
+            break;
+        case S_CLASS_DEFINITION:
+            visitList(left);
+            visitList(right);
+            break;
+        case S_IF_FLOW:
+            visit(left);
+            visitList(right);
+            visitList(right + 2);
+            break;
+        case S_IMPORT:
+        case S_BREAK:
+        case S_CONTINUE:
+        case E_LITERAL:
+        case E_IDENTIFIER:
+            break;
+        case E_CALL:
+            visit(left);
+            visitList(right);
+            break;
+        default:
+            visit(left);
+            visit(right);
+            break;
+    }
+}
+
+void TypeInference::infer(NodeList statements) {
+    types.assign(ast.size(), NATIVE_NONE);
+    storages.assign(ast.size(), STORAGE_GLOBAL);
+    reads.assign(ast.size(), true);
+    resolved.assign(ast.size(), -1);
+    variables.clear();
+    assigned.clear();
+    pending.clear();
+    inferBody(statements, true);
+    while (!pending.empty()) {
+        auto body = pending.back();
+        pending.pop_back();
+        inferBody(body, false);
+    }
+}
+
+NativeType TypeInference::type(NodeId declaration) const {
+    return declaration < types.size() ? types[declaration] : NATIVE_NONE;
+}
+
+Storage TypeInference::storage(NodeId declaration) const {
+    return declaration < storages.size() ? storages[declaration] : STORAGE_GLOBAL;
+}
+
+bool TypeInference::read(NodeId declaration) const {
+    return declaration >= reads.size() || reads[declaration];
+}
+
+bool TypeInference::reassigned(Atom name) const {
+    return assigned.count(name) > 0;
+}
+
+void TypeInference::inferBody(NodeList statements, bool program) {
+    auto first = variables.size();
+    scopes.assign(1, {});
+    captured.clear();
+    walkStatements(statements);
+
+    auto body = variables.begin() + first;
+    for (auto variable = body; variable != variables.end(); ++variable) {
+        variable->type = captured.count(variable->name) ? NATIVE_NONE : NATIVE_UNKNOWN;
+    }
+    // types only go from unknown to int or double and from there to none, so this ends
+    auto changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = body; it != variables.end(); ++it) {
+            auto &variable = *it;
+            if (variable.type == NATIVE_NONE) {
+                continue;
+            }
+            auto type = NATIVE_UNKNOWN;
+            for (auto definition: variable.definitions) {
+                auto defined = definitionType(variable, definition);
+                if (defined == NATIVE_BOOL || (type != NATIVE_UNKNOWN && defined != NATIVE_UNKNOWN && defined != type)) {
+                    type = NATIVE_NONE;
+                    break;
+                }
+                if (defined != NATIVE_UNKNOWN) {
+                    type = defined;
+                }
+            }
+            if (type != variable.type) {
+                variable.type = type;
+                changed = true;
+            }
+        }
+    }
+    for (auto variable = body; variable != variables.end(); ++variable) {
+        if (variable->type == NATIVE_INT || variable->type == NATIVE_DOUBLE) {
+            types[variable->declaration] = variable->type;
+        }
+        if (!captured.count(variable->name) && !(program && variable->topLevel)) {
+            storages[variable->declaration] = STORAGE_LOCAL;
+        }
+        reads[variable->declaration] = variable->read;
+    }
+}
+
+void TypeInference::walkStatements(NodeList statements) {
+    // the scopes are the ones of Compiler::compileScope
+    for (auto statement: statements) {
+        auto token = ast.tokens[statement];
+        switch (ast.kinds[statement]) {
+            case S_VARIABLE_DECLARATION: {
+                walkExpression(ast.lhs[statement]);
+                if (token->atom == A_NONE) {
+                    scopes.back()[atomTable.intern(token->value)] = -1;
+                    break;
+                }
+                scopes.back()[token->atom] = (int) variables.size();
+                variables.push_back({statement, token->atom, NATIVE_UNKNOWN, scopes.size() == 1, false, {statement}});
+                break;
+            }
+            case S_FUNCTION_DECLARATION:
+                scopes.back()[token->atom] = -1;
+                capture(statement);
+                pending.push_back(ast.list(ast.rhs[statement]));
+                break;
+            case S_DO:
+            case S_LOOP:
+                scopes.emplace_back();
+                walkStatements(ast.list(ast.lhs[statement]));
+                scopes.pop_back();
+                break;
+            case S_IF_FLOW:
+                walkExpression(ast.lhs[statement]);
+                scopes.emplace_back();
+                walkStatements(ast.list(ast.rhs[statement]));
+                scopes.back().clear();
+                walkStatements(ast.list(ast.rhs[statement] + 2));
+                scopes.pop_back();
+                break;
+            case S_RETURN:
+            case S_EXPRESSION:
+                walkExpression(ast.lhs[statement]);
+                break;
+            case S_BREAK:
+            case S_CONTINUE:
+                break;
+            default:
+                // not compiled, nothing it names is kept native
+                capture(statement);
+                break;
+        }
+    }
+}
+
+void TypeInference::walkExpression(NodeId expression) {
+    if (expression == NO_NODE) {
+        return;
+    }
+    switch (ast.kinds[expression]) {
+        case E_IDENTIFIER:
+            resolved[expression] = resolve(ast.tokens[expression]->atom);
+            if (resolved[expression] != -1) {
+                variables[resolved[expression]].read = true;
+            }
+            break;
+        case E_ASSIGNMENT:
+            walkTarget(expression, ast.lhs[expression]);
+            walkExpression(ast.rhs[expression]);
+            break;
+        case E_UPDATE:
+            walkTarget(expression, ast.lhs[expression]);
+            break;
+        default:
+            forChildren(ast, expression, [&](NodeId child) {
+                walkExpression(child);
+            });
+            break;
+    }
+}
+
+void TypeInference::walkTarget(NodeId definition, NodeId target) {
+    auto kind = ast.kinds[target];
+    if (kind == E_ARRAY || kind == E_OBJECT) {
+        // what a pattern stores in each target is only known at run time, the target stands for it
+        forChildren(ast, target, [&](NodeId element) {
+            auto inner = ast.kinds[element] == E_PROPERTY ? ast.rhs[element] : element;
+            walkTarget(inner, inner);
+        });
+        return;
+    }
+    if (ast.kinds[target] != E_IDENTIFIER) {
+        walkExpression(target);
+        return;
+    }
+    // x = value does not read x, x += value and x++ do
+    auto plain = ast.kinds[definition] != E_UPDATE && (ast.kinds[definition] != E_ASSIGNMENT ||
+                                                       ast.tokens[definition]->value == "=");
+    resolved[target] = resolve(ast.tokens[target]->atom);
+    if (resolved[target] != -1 && !plain) {
+        variables[resolved[target]].read = true;
+    }
+    assigned.insert(ast.tokens[target]->atom);
+    if (resolved[target] != -1) {
+        variables[resolved[target]].definitions.push_back(definition);
+    }
+}
+
+int TypeInference::resolve(Atom name) const {
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        auto it = scope->find(name);
+        if (it != scope->end()) {
+            return it->second;
+        }
+    }
+    return -1;
+}
+
+void TypeInference::capture(NodeId node) {
+    if (node == NO_NODE) {
+        return;
+    }
+    if (ast.kinds[node] == E_IDENTIFIER) {
+        captured.insert(ast.tokens[node]->atom);
+        return;
+    }
+    forChildren(ast, node, [&](NodeId child) {
+        capture(child);
+    });
+}
+
+NativeType TypeInference::expressionType(NodeId expression) const {
+    if (expression == NO_NODE) {
+        return NATIVE_NONE;
+    }
+    auto token = ast.tokens[expression];
+    switch (ast.kinds[expression]) {
+        case E_LITERAL:
+            return literalType(token);
+        case E_IDENTIFIER:
+            return resolved[expression] == -1 ? NATIVE_NONE : variables[resolved[expression]].type;
+        case E_UNARY: {
+            auto type = expressionType(ast.lhs[expression]);
+            if (token->value == "+" || (token->value == "-" && type != NATIVE_BOOL)) {
+                return type;
+            }
+            return NATIVE_NONE;
+        }
+        case E_BINARY:
+            return binaryType(token->value, expressionType(ast.lhs[expression]), expressionType(ast.rhs[expression]));
+        default:
+            return NATIVE_NONE;
+    }
+}
+
+NativeType TypeInference::definitionType(const Variable &variable, NodeId definition) const {
+    auto token = ast.tokens[definition];
+    switch (ast.kinds[definition]) {
+        case S_VARIABLE_DECLARATION:
+            return expressionType(ast.lhs[definition]);
+        case E_ASSIGNMENT: {
+            auto value = expressionType(ast.rhs[definition]);
+            if (token->value == "=") {
+                return value;
+            }
+            // a += b is a = a + b
+            return binaryType(token->value.substr(0, token->value.size() - 1), variable.type, value);
+        }
+        case E_UPDATE:
+            return binaryType("+", variable.type, NATIVE_INT);
+        default:
+            return NATIVE_NONE;
+    }
+}
@@ -1,10 +1,12 @@
 #include "lexer.hpp"
+#include "dump.hpp"
 #include "error.hpp"
+#include "charclass.hpp"
 #include <string>
 #include <iostream>
-#include <unordered_set>
+#include <sstream>
+#include <array>
 #include <unordered_map>
-#include <regex>
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wtrigraphs"
@@ -12,15 +14,105 @@ using namespace std;
 
 // operators: + - * / % ** & | ^ << >> ~ && || > < <= >= == != !
 
-unordered_set<char> whitespace = {' ', '\t', '\r', '\v'};
-unordered_set<char> symbols = {'.', ',', ':', ';', '\\'};
-unordered_set<char> paren = {'(', ')', '{', '}', '[', ']'};
-unordered_set<char> singleOperators = {'+', '-', '*', '/', '%', '&', '|', '^', '~', '>', '<', '!', '='};
-unordered_set<string> doubleOperators = {"**", "<<", ">>", "&&", "||", "<=", ">=", "==", "!="};
-unordered_set<string> doubleSetOperators = {"+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "~=", ":="};
-unordered_set<string> tripleSetOperators = {"<<=", ">>=", "&&=", "||=", "**="};
-unordered_set<string> keywords = {"let", "const", "if", "for", "loop", "while", "return", "break", "continue", "fn",
-                                  "class", "import", "in", "switch", "match", "case", "default", "throw"};
+// Keywords are found with a perfect hash over (length, first character, last character), the table is built and
+// checked for collisions at compile time.
+constexpr string_view keywordList[] = {"let", "const", "if", "for", "loop", "while", "return", "break", "continue",
+                                       "fn", "class", "import", "in", "switch", "match", "case", "default", "throw"};
+constexpr size_t keywordCount = sizeof(keywordList) / sizeof(keywordList[0]);
+constexpr uint8_t NO_KEYWORD = 0xFF;
+
+constexpr size_t keywordHash(string_view word) {
+    return (word.size() + (uint8_t) word[0] * 8 + (uint8_t) word[word.size() - 1]) & 63;
+}
+
+constexpr array<uint8_t, 64> makeKeywordTable() {
+    array<uint8_t, 64> table{};
+    for (auto &slot: table) slot = NO_KEYWORD;
+    for (size_t i = 0; i < keywordCount; i++) table[keywordHash(keywordList[i])] = i;
+    return table;
+}
+
+constexpr array<uint8_t, 64> keywordTable = makeKeywordTable();
+
+constexpr bool keywordTableIsPerfect() {
+    for (size_t i = 0; i < keywordCount; i++) {
+        if (keywordTable[keywordHash(keywordList[i])] != i) return false;
+    }
+    return true;
+}
+
+static_assert(keywordTableIsPerfect(), "keywordHash has collisions, pick other multipliers");
+
+constexpr bool keywordAtomsMatch() {
+    for (size_t i = 0; i < keywordCount; i++) {
+        if (predefinedAtomNames[A_LET + i] != keywordList[i]) return false;
+    }
+    return true;
+}
+
+static_assert(keywordAtomsMatch(), "the keyword atoms must follow keywordList");
+
+// The keyword's atom, or A_NONE if the word isn't one.
+Atom keywordAtom(string_view word) {
+    if (word.size() < 2 || word.size() > 8) return A_NONE;
+    auto i = keywordTable[keywordHash(word)];
+    return i != NO_KEYWORD && keywordList[i] == word ? A_LET + i : A_NONE;
+}
+
+// Matches the longest operator at p, chr2 and chr3 are '\0' past the end of the code.
+// operators: + - * / % ** & | ^ << >> ~ && || > < <= >= == != !
+// set operators: += -= *= /= %= &= |= ^= ~= := <<= >>= &&= ||= **=
+// ++, -- and comments are handled before this.
+size_t matchOperator(char chr, char chr2, char chr3, TokenType &type) {
+    type = T_OPERATOR;
+    switch (chr) {
+        case '<':
+        case '>':
+        case '&':
+        case '|':
+        case '*':
+            if (chr2 == chr) {
+                if (chr3 == '=') {
+                    type = T_SET_OPERATOR;
+                    return 3;
+                }
+                return 2;
+            }
+            if (chr2 == '=') {
+                if (chr == '<' || chr == '>') return 2;
+                type = T_SET_OPERATOR;
+                return 2;
+            }
+            return 1;
+        case '=':
+        case '!':
+            return chr2 == '=' ? 2 : 1;
+        case '+':
+        case '-':
+        case '/':
+        case '%':
+        case '^':
+        case '~':
+            if (chr2 == '=') {
+                type = T_SET_OPERATOR;
+                return 2;
+            }
+            return 1;
+        case ':':
+            if (chr2 == '=') {
+                type = T_SET_OPERATOR;
+                return 2;
+            }
+            return 0; // symbol
+        default:
+            return 0;
+    }
+}
+
+char closingParen(char open) {
+    return open == '(' ? ')' : open == '[' ? ']' : '}';
+}
+
 unordered_map<TokenType, string> tokenTypeToString = {
         {T_NUMBER,              "number"},
         {T_STRING,              "string"},
@@ -38,19 +130,14 @@ unordered_map<TokenType, string> tokenTypeToString = {
         {T_RANGE,               "range"},
         {T_INTERNAL_IDENTIFIER, "internal identifier"}
 };
-unordered_map<string, string> parenMap = {
-        {"(", ")"},
-        {"{", "}"},
-        {"[", "]"}
-};
 
-vector<vector<Token *>> splitTokens(vector<Token *> tokens, string delim, bool emptyError) {
+vector<vector<Token *>> splitTokens(TokenList tokens, string delim, bool emptyError) {
     vector<vector<Token *>> result;
     vector<Token *> current;
     for (auto token: tokens) {
         if (token->value == delim) {
             if (emptyError && current.empty()) {
-                token->throwError("SyntaxError: Unexpected token '" + token->value + "'");
+                token->throwError("SyntaxError: Unexpected token '" + string(token->value) + "'");
             }
             result.push_back(current);
             current.clear();
@@ -64,60 +151,59 @@ vector<vector<Token *>> splitTokens(vector<Token *> tokens, string delim, bool e
     return result;
 }
 
-string tokensToString(const string &pre, vector<Token *> tokens) {
-    string childrenStr;
-    string nl = "\n" + pre;
-    for (auto &token: tokens) {
-        childrenStr += pre + regex_replace(token->toString(), regex("\n"), nl) +
-                       (token != tokens.back() ? ",\n" : "");
+string stringLiteral(string_view value) {
+    // string tokens are views of the raw source, literals have to stay on a single line
+    string res;
+    res.reserve(value.size());
+    for (auto chr: value) {
+        if (chr == '\r') continue;
+        if (chr == '\n') {
+            res += '\\';
+            res += 'n';
+        } else {
+            res += chr;
+        }
     }
-    return childrenStr;
+    return res;
 }
 
-string tokensListToString(const string &pre, vector<vector<Token *>> tokens) {
-    string childrenStr;
-    string nl = "\n" + pre;
-    for (auto &token: tokens) {
-        childrenStr += pre + tokensToString(pre, token) + (token != tokens.back() ? ",\n" : "");
-    }
-    return childrenStr;
+const string &tokenTypeName(TokenType type) {
+    return tokenTypeToString.find(type)->second;
 }
 
-string Token::toString() {
-    if (type == T_GROUP) {
-        return "{'type': '" + tokenTypeToString.find(T_GROUP)->second + "', 'children': [\n" +
-               tokensToString("    ", children) + "\n  ]\n}";
-    }
-    auto val = value;
-    if (val == "\n") {
-        val = "\\n";
-    }
-    return "{'type': '" + tokenTypeToString.find(type)->second + "', 'value': '" + val + "'}";
+string Token::toString() const {
+    ostringstream out;
+    JsonWriter json(out);
+    writeToken(json, this);
+    return out.str();
 }
 
 void Token::throwError(const std::string &message) const {
-    ::throwError(message, filename, code, start);
+    auto at = start;
+    auto current = source->forward(at);
+    ::throwError(message, current, at);
 }
 
-void Token::showError(const std::string &message) const {
-    ::showError(message, filename, code, start);
+void Token::reportError(const std::string &message) const {
+    auto at = start;
+    auto current = source->forward(at);
+    ::reportError(message, current, at);
 }
 
-__attribute__((unused)) void Token::dump() {
-    cout << toString() << endl;
+void Token::showError(const std::string &message) const {
+    auto at = start;
+    auto current = source->forward(at);
+    ::showError(message, current, at);
 }
 
-void Token::updateValue() {
-    this->value = this->code.substr(this->start, this->end - this->start);
+__attribute__((unused)) void Token::dump() const {
+    JsonWriter json(cout);
+    writeToken(json, this);
+    cout << endl;
 }
 
-void Token::free(bool freeChildren) {
-    if (freeChildren) {
-        for (auto token: children) {
-            token->free(freeChildren);
-        }
-    }
-    delete this;
+void Token::updateValue() {
+    this->value = source->code.substr(start, end - start);
 }
 
 char Lexer::peek(size_t offset) {
@@ -136,212 +222,243 @@ char Lexer::current() {
     return peek(0);
 }
 
+static void writeLexer(ostream &out, TokenList tokens) {
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("tokens");
+    writeTokens(json, tokens);
+    json.endObject();
+}
+
 string Lexer::toString() const {
-    return "{\n  'tokens': [\n" + tokensToString("    ", tokens) + "\n  ]\n}";
+    ostringstream out;
+    writeLexer(out, tokens);
+    return out.str();
 }
 
 __attribute__((unused)) void Lexer::dump() const {
-    cout << toString() << endl;
+    writeLexer(cout, tokens);
+    cout << endl;
 }
 
 void Lexer::throwError(const string &message, size_t index_) const {
-    ::throwError(message, filename, code, index_);
+    ::throwError(message, source.get(), index_);
+}
+
+void Lexer::reportError(const string &message, size_t index_) const {
+    ::reportError(message, source.get(), index_);
 }
 
 void Lexer::showError(const string &message, size_t index_) const {
-    ::showError(message, filename, code, index_);
+    ::showError(message, source.get(), index_);
 }
 
 void Lexer::tokenize() {
-    code.size();
+    stream.reserve(stream.size() + code.size() / 8); // about one token every 6 to 8 bytes in typical code
+    tokenizeRange(0, code.size());
+    tokens = stream;
+}
+
+size_t Lexer::tokenizeRange(size_t from, size_t to) {
+    auto src = source.get();
+    auto begin = code.data();
+    auto end = begin + code.size();
+    size_t nextChunk = from;
+    index = from - 1;
     while (true) {
         auto chr = next();
-        auto chrStr = string(1, chr);
         auto si = index;
 
-        if (chr == '\0') {
-            break;
+        if (si >= nextChunk) {
+            // large inputs are lexed one window at a time, the next one is read in while this one is lexed
+            source->prefetch(nextChunk + SOURCE_CHUNK_SIZE, SOURCE_CHUNK_SIZE);
+            nextChunk += SOURCE_CHUNK_SIZE;
+        }
+
+        if (chr == '\0' || si >= to) {
+            return si;
         }
-        if (whitespace.find(chr) != whitespace.end()) {
+        auto cls = charClassTable[(uint8_t) chr];
+        if (cls & C_WHITESPACE) {
+            index = skipWhitespace(begin + si + 1, end) - begin - 1;
             continue;
         }
         if (chr == '\n') {
-            tokens.push_back(new Token(T_EOL, filename, code, si, si + 1, chrStr));
+            stream.push_back(arena->make<Token>(T_EOL, src, si, si + 1));
             continue;
         }
         if (chr == ';') {
-            tokens.push_back(new Token(T_EOE, filename, code, si, si + 1, chrStr));
+            stream.push_back(arena->make<Token>(T_EOE, src, si, si + 1));
             continue;
         }
         auto chr1 = peek(1); // next token
-        auto chr1str = chrStr + chr1;
         if (chr == '/' && chr1 == '/') {
-            while (true) {
-                auto chr2 = next();
-                if (chr2 == '\n' || chr2 == '\0') {
-                    break;
-                }
-            }
-            --index;
+            index = findEither(begin + si + 2, end, '\n', '\0') - begin - 1;
             continue;
         }
         if (chr == '/' && chr1 == '*') {
+            auto p = begin + si + 1;
             while (true) {
-                auto chr2 = next();
-                if (chr2 == '\0') {
+                p = findEither(p, end, '*', '\0');
+                if (p == end || *p == '\0') {
+                    index = p - begin;
                     break; // unterminated comment, but it doesn't matter, I guess, maybe throw an error
                 }
-                if (chr2 == '*' && peek(1) == '/') {
-                    ++index;
+                if (p + 1 < end && p[1] == '/') {
+                    index = p + 1 - begin;
                     break;
                 }
+                ++p;
             }
             continue;
         }
         if ((chr == '+' || chr == '-') && chr1 == chr) {
-            tokens.push_back(new Token(T_INC_OPERATOR, filename, code, si, si + 2, chr1str));
-            ++index;
-            continue;
-        }
-
-        if (paren.find(chr) != paren.end()) {
-            tokens.push_back(new Token(T_PAREN, filename, code, si, si + 1, chrStr));
-            continue;
-        }
-
-        auto chr2 = peek(2); // double next token
-        auto chr2str = chrStr + chr1 + chr2;
-        if (tripleSetOperators.find(chr2str) != doubleSetOperators.end()) {
-            tokens.push_back(new Token(T_SET_OPERATOR, filename, code, si, si + 1, chr2str));
-            index += 2;
-            continue;
-        }
-
-        if (doubleOperators.find(chr1str) != doubleOperators.end()) {
-            tokens.push_back(new Token(T_OPERATOR, filename, code, si, si + 1, chr1str));
+            stream.push_back(arena->make<Token>(T_INC_OPERATOR, src, si, si + 2));
             ++index;
             continue;
         }
 
-        if (doubleSetOperators.find(chr1str) != doubleSetOperators.end()) {
-            tokens.push_back(new Token(T_SET_OPERATOR, filename, code, si, si + 1, chr1str));
-            ++index;
+        if (cls & C_PAREN) {
+            stream.push_back(arena->make<Token>(T_PAREN, src, si, si + 1));
             continue;
         }
 
-        if (singleOperators.find(chr) != singleOperators.end()) {
-            tokens.push_back(new Token(T_OPERATOR, filename, code, si, si + 1, chrStr));
-            continue;
+        if ((cls & C_OPERATOR) || chr == ':') {
+            TokenType type;
+            auto length = matchOperator(chr, chr1, peek(2), type);
+            if (length > 0) {
+                stream.push_back(arena->make<Token>(type, src, si, si + length));
+                index += length - 1;
+                continue;
+            }
         }
 
-        if (isdigit(chr) || (chr == '.' && isdigit(chr1))) {
+        if ((cls & C_DIGIT) || (chr == '.' && isCharClass(chr1, C_DIGIT))) {
             bool is_float = chr == '.';
-            while ((chr = next()) != '\0' && (isdigit(chr) || (!is_float && chr == '.' && peek(1) != '.'))) {
-                if (chr == '.') {
-                    is_float = true;
-                }
+            auto p = skipDigits(begin + si + 1, end);
+            if (!is_float && p < end && *p == '.' && (p + 1 == end || p[1] != '.')) {
+                p = skipDigits(p + 1, end);
             }
+            index = p - begin;
+            chr = current();
             if (chr == 'e') {
                 ++index;
                 chr = peek(1);
                 if (chr == '+' || chr == '-') {
                     ++index;
                 }
-                if (!isdigit(peek(1))) {
-                    throwError("SyntaxError: Expected an integer", index);
+                if (!isCharClass(peek(1), C_DIGIT)) {
+                    reportError("SyntaxError: Expected an integer", index);
                 }
-                while ((chr = next()) != '\0' && isdigit(chr)) {
+                while ((chr = next()) != '\0' && isCharClass(chr, C_DIGIT)) {
                 }
             }
             if (chr == 'n') {
                 ++index;
             }
-            tokens.push_back(new Token(T_NUMBER, filename, code, si, index));
+            stream.push_back(arena->make<Token>(T_NUMBER, src, si, index));
             --index;
             continue;
         }
-        if (symbols.find(chr) != symbols.end()) {
-            tokens.push_back(new Token(T_SYMBOL, filename, code, si, si + 1, chrStr));
+        if (cls & C_SYMBOL) {
+            stream.push_back(arena->make<Token>(T_SYMBOL, src, si, si + 1));
             continue;
         }
         if (chr == '"' or chr == '\'') {
             char startChar = chr;
-            string res = string(1, chr);
             bool backslash = false;
             while ((chr = next()) != '\0' && (chr != startChar || backslash)) {
                 if (chr == '\\') backslash = !backslash;
                 else backslash = false;
-                if (chr == '\r') continue;
-                if (chr == '\n') {
-                    res += '\\';
-                    res += 'n';
-                } else {
-                    res += chr;
-                }
             }
             if (chr == '\0') {
-                throwError("SyntaxError: Unterminated string", si);
+                // the rest of the code is in the string, there is nothing left to lex
+                reportError("SyntaxError: Unterminated string", si);
+                return index;
             }
-            res += chr;
-            tokens.push_back(new Token(T_STRING, filename, code, si, index, res));
+            stream.push_back(arena->make<Token>(T_STRING, src, si, index + 1));
             continue;
         }
 
-        if (isalpha(chr) || chr == '_') {
-            string res = string(1, chr);
-            while ((chr = next()) != '\0' && (isalnum(chr) || chr == '_')) {
-                res += chr;
+        if (cls & C_IDENTIFIER_START) {
+            index = skipIdentifier(begin + si + 1, end) - begin;
+            auto token = arena->make<Token>(T_IDENTIFIER, src, si, index);
+            token->atom = keywordAtom(token->value);
+            if (token->atom != A_NONE) {
+                token->type = T_KEYWORD;
+            } else {
+                token->atom = atomTable.intern(token->value);
             }
+            stream.push_back(token);
             --index;
-            if (keywords.find(res) != keywords.end()) {
-                tokens.push_back(new Token(T_KEYWORD, filename, code, si, index, res));
-                continue;
-            }
-            tokens.push_back(new Token(T_IDENTIFIER, filename, code, si, index, res));
             continue;
         }
 
-        throwError("SyntaxError: Unexpected character", index);
+        reportError("SyntaxError: Unexpected character", index);
     }
 }
 
+TokenList Lexer::copyTokens(Token *const *items, size_t count) {
+    auto list = TokenList(arena->makeArray<Token *>(count), count);
+    copy(items, items + count, list.items);
+    return list;
+}
+
 void Lexer::groupTokens() {
-    auto program = new Token(T_GROUP, filename, code, 0, code.size());
-    auto parent = program;
-    for (auto token: tokens) {
+    tokens = groupStream(stream.data(), stream.size(), nullptr);
+    stream = vector<Token *>();
+}
+
+TokenList Lexer::groupStream(Token *const *items, size_t count, Token *parent) {
+    // Children of all the open groups are collected in one stack, innermost group last. Once a group is closed
+    // its children are copied next to each other into the arena and popped.
+    vector<Token *> pending;
+    vector<size_t> marks; // where the children of each open group start in pending
+    vector<Token *> open;
+    for (auto token: TokenList((Token **) items, count)) {
         if (token->type == T_PAREN && (token->value == "(" || token->value == "[" || token->value == "{")) {
-            auto group = new Token(T_GROUP, filename, code, token->start, token->end, token->value);
-            token->free();
-            group->parent = parent;
-            parent->children.push_back(group);
-            parent = group;
+            // the opening parenthesis becomes the group itself
+            token->type = T_GROUP;
+            token->parent = open.empty() ? parent : open.back();
+            pending.push_back(token);
+            marks.push_back(pending.size());
+            open.push_back(token);
         } else if (token->type == T_PAREN &&
                    (token->value == ")" || token->value == "]" || token->value == "}")) {
-            if (parent == program || token->value != parenMap.find(parent->value)->second) {
-                token->throwError("SyntaxError: Unexpected token '" + token->value + "'");
+            if (open.empty() || token->value[0] != closingParen(open.back()->value[0])) {
+                token->reportError("SyntaxError: Unexpected token '" + string(token->value) + "'");
+                continue;
             }
-            parent->end = token->end;
-            parent->updateValue();
-            token->free();
-            parent = parent->parent;
+            auto group = open.back();
+            auto mark = marks.back();
+            group->end = token->end;
+            group->updateValue();
+            group->children = copyTokens(pending.data() + mark, pending.size() - mark);
+            pending.resize(mark);
+            marks.pop_back();
+            open.pop_back();
         } else {
-            parent->children.push_back(token);
+            pending.push_back(token);
         }
     }
-    if (parent != program) {
-        parent->throwError("SyntaxError: Unterminated parenthesis");
+    // groups still open at the end are closed there, so the tree is complete for whoever reads the errors
+    while (!open.empty()) {
+        auto group = open.back();
+        auto mark = marks.back();
+        group->reportError("SyntaxError: Unterminated parenthesis");
+        group->children = copyTokens(pending.data() + mark, pending.size() - mark);
+        pending.resize(mark);
+        marks.pop_back();
+        open.pop_back();
     }
-    tokens.clear();
-    tokens = program->children;
-    program->free(false);
+    return copyTokens(pending.data(), pending.size());
 }
 
 void Lexer::freeTokens() {
-    for (auto &token: tokens) {
-        token->free();
-    }
-    tokens.clear();
-    eof->free();
+    // every token of the compilation lives in the arena, there is nothing to walk
+    tokens = TokenList();
+    stream = vector<Token *>();
+    arena->reset();
 }
 
 #pragma clang diagnostic pop
\ No newline at end of file
@@ -1,41 +1,151 @@
+#include "cache.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
 #include "compiler.hpp"
+#include "incremental.hpp"
 #include "error.hpp"
-#include <sstream>
-#include <fstream>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <thread>
 
+#ifndef WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        cout << "usage: neolang <file>" << endl;
-        return 1;
+static void compileAndRun(Parser &parser, const BuildOptions &options) {
+#ifndef WIN32
+    // compile errors exit, keep watching after them
+    cout.flush();
+    auto pid = fork();
+    if (pid == 0) {
+        Compiler(parser, options).compile();
+        exit(0);
+    }
+    if (pid > 0) {
+        waitpid(pid, nullptr, 0);
+        return;
     }
-    auto filename = argv[1];
-    ifstream file(filename);
-    if (!file.is_open()) {
+#endif
+    Compiler(parser, options).compile();
+}
+
+static int watch(const string &filename, const BuildOptions &options) {
+    // editors often rewrite the file in place, so the document keeps a copy instead of a mapping
+    auto source = Source::load(filename, false);
+    if (source == nullptr) {
         cout << "error: could not open file '" << filename << "'" << endl;
         return 1;
     }
+    Arena arena;
+    Document document(source, &arena);
+    if (diagnostics.hasErrors()) {
+        diagnostics.flush();
+    } else {
+        compileAndRun(document.parser, options);
+    }
 
-    stringstream buffer;
-    buffer << file.rdbuf();
+    error_code error;
+    auto modified = filesystem::last_write_time(filename, error);
+    while (true) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        auto time = filesystem::last_write_time(filename, error);
+        if (error || time == modified) {
+            continue;
+        }
+        modified = time;
+        source = Source::load(filename, false);
+        if (source == nullptr) {
+            continue;
+        }
+        document.update(source);
+        cout << "--- " << filename << " changed" << endl;
+        if (diagnostics.hasErrors()) {
+            diagnostics.flush();
+            continue;
+        }
+        compileAndRun(document.parser, options);
+    }
+}
+
+static int usage() {
+    cout << "usage: neolang [--watch | --tokens | --ast] [--debug | --release | -O<0-3>] [--native] [--lto]"
+            " [--pgo <training input>] <file>, use - to read the program from stdin" << endl;
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    string mode;
+    BuildOptions options;
+    int i = 1;
+    for (; i < argc - 1; i++) {
+        string option = argv[i];
+        if (option == "--watch" || option == "--tokens" || option == "--ast") {
+            if (!mode.empty()) {
+                return usage();
+            }
+            mode = option;
+        } else if (option == "--debug") {
+            options.profile = BUILD_DEBUG;
+        } else if (option == "--release") {
+            options.profile = BUILD_RELEASE;
+        } else if (option.size() == 3 && option[0] == '-' && option[1] == 'O' && option[2] >= '0' && option[2] <= '3') {
+            options.profile = BUILD_RELEASE;
+            options.level = option[2] - '0';
+        } else if (option == "--native") {
+            options.native = true;
+        } else if (option == "--lto") {
+            options.lto = true;
+        } else if (option == "--pgo" && i + 2 < argc) {
+            options.training = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+    if (i != argc - 1) {
+        return usage();
+    }
+    auto filename = argv[argc - 1];
+    if (mode == "--watch") {
+        return watch(filename, options);
+    }
+    auto source = Source::load(filename);
+    if (source == nullptr) {
+        cout << "error: could not open file '" << filename << "'" << endl;
+        return 1;
+    }
 
-    auto lexer = Lexer(buffer.str(), filename);
-    lexer.tokenize();
-    lexer.groupTokens();
+    Arena arena;
+    auto parser = Parser(Lexer(source, &arena));
+    if (mode == "--tokens") {
+        parser.lexer.tokenize();
+        parser.lexer.groupTokens();
+        diagnostics.exitOnErrors();
+        parser.lexer.dump();
+        return 0;
+    }
+    ParseCache cache;
+    if (!cache.load(parser)) {
+        parser.lexer.tokenize();
+        parser.lexer.groupTokens();
+        diagnostics.exitOnErrors();
+        parser.parse();
+        diagnostics.exitOnErrors();
+        cache.save(parser);
+    }
 
-    auto parser = Parser(lexer);
-    parser.parse();
+    if (mode == "--ast") {
+        parser.dump();
+        return 0;
+    }
 
-    auto compiler = Compiler(parser);
+    auto compiler = Compiler(parser, options);
     compiler.compile();
 
-    lexer.freeTokens();
+    parser.lexer.freeTokens();
 
-    file.close();
     return 0;
-}
\ No newline at end of file
+}
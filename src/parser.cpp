@@ -1,37 +1,18 @@
+#include <algorithm>
 #include <iostream>
-#include <regex>
+#include <sstream>
+#include <thread>
 #include "parser.hpp"
+#include "dump.hpp"
+#include "error.hpp"
 
 using namespace std;
 
-vector<vector<Token *>> separateExpression(vector<Token *> tokens) {
-    // Separates tokens by operators
-    // ! a + - b * + c -> [[!, a], [+], [-, b], [*], [+, c]]
-    vector<vector<Token *>> sep;
-    if (tokens.size() == 0) {
-        return sep;
-    }
-    vector<Token *> current;
-    for (auto &token: tokens) {
-        if (IsAnyOperatorToken(token) && current.size() > 0) {
-            sep.push_back(current);
-            sep.push_back({token});
-            current.clear();
-            continue;
-        }
-        current.push_back(token);
-    }
-    if (current.size() > 0) {
-        sep.push_back(current);
-    } else sep.back()[0]->throwError("SyntaxError: Expected expression after operator");
-    return sep;
-}
-
 Token *Parser::peek(size_t offset) const {
-    if (index + offset >= lexer.tokens.size()) {
+    if (index + offset >= tokens.size()) {
         return lexer.eof;
     }
-    return lexer.tokens[index + offset];
+    return tokens[index + offset];
 }
 
 Token *Parser::next(size_t offset) {
@@ -43,14 +24,45 @@ Token *Parser::current() const {
     return peek(0);
 }
 
-Token *Parser::accumulate(size_t offset) {
-    auto nx = next(offset);
-    accumulator.push_back(nx);
-    return nx;
+void Parser::parseBlock(Token *group, TokenList block, uint32_t slot) {
+    // the cursor of the enclosing block is put back afterwards, everything else is shared
+    auto outerTokens = tokens;
+    auto outerIndex = index;
+    auto outerOutput = output;
+    tokens = block;
+    index = -1;
+    output = ast.beginList();
+    parseStatements();
+    ast.endList(output, slot);
+    tokens = outerTokens;
+    index = outerIndex;
+    output = outerOutput;
+    if (group != nullptr && group->type == T_GROUP && group->value[0] == '{') {
+        blocks[group] = slot;
+    }
+}
+
+void Parser::forgetBlocks(TokenList block) {
+    for (auto token: block) {
+        if (token->type == T_GROUP) {
+            blocks.erase(token);
+            forgetBlocks(token->children);
+        }
+    }
+}
+
+TokenList Parser::restOfLine() {
+    // the tokens from the current one up to the end of the line, they are next to each other in the enclosing block
+    auto start = index;
+    auto t = current();
+    while (t != lexer.eof && t->type != T_EOL && t->type != T_EOE) {
+        t = next();
+    }
+    return TokenList(tokens.items + start, index - start);
 }
 
 void Parser::parseVariableDeclarationStatement() {
-    auto constant = current()->value == "const";
+    auto constant = current()->atom == A_CONST;
 
     auto name = next();
     if (name->type != T_IDENTIFIER && (name->type != T_GROUP || (name->value[0] != '[' && name->value[0] != '{'))) {
@@ -68,13 +80,9 @@ void Parser::parseVariableDeclarationStatement() {
         peek(0)->throwError("SyntaxError: Expected '='");
     }
 
-    Token *t;
-    accumulator = vector<Token *>();
-    while ((t = accumulate()) != lexer.eof && t->type != T_EOL && t->type != T_EOE) {}
-    accumulator.pop_back();
-    auto value = accumulator;
-
-    statements.push_back(make_unique<VariableDeclarationStatement>(name, value, constant));
+    next();
+    auto value = parseExpression(ast, restOfLine());
+    ast.scratch.push_back(ast.add(S_VARIABLE_DECLARATION, name, value, NO_NODE, constant ? F_CONSTANT : 0));
 }
 
 void Parser::parseFunctionDeclarationStatement() {
@@ -91,36 +99,45 @@ void Parser::parseFunctionDeclarationStatement() {
     }
     auto body = next();
 
-    auto ps = Parser(Lexer(lexer.code, lexer.filename, body->children));
-    ps.parse();
-
-    statements.push_back(make_unique<FunctionDeclarationStatement>(
-            name, splitTokens(args->children, ","), std::move(ps.statements)));
+    auto arguments = splitTokens(args->children, ",");
+    auto parameters = ast.reserve(1 + 2 * arguments.size());
+    ast.extra[parameters] = arguments.size();
+    for (size_t i = 0; i < arguments.size(); i++) {
+        ast.extra[parameters + 1 + 2 * i] = ast.addTokens(arguments[i]);
+        ast.extra[parameters + 2 + 2 * i] = arguments[i].size();
+    }
+    auto slot = ast.reserve(2);
+    if (deferring && tokens.items == lexer.tokens.items && body->type == T_GROUP) {
+        deferred.emplace_back(body, slot);
+    } else {
+        parseBlock(body, body->children, slot);
+    }
+    ast.scratch.push_back(ast.add(S_FUNCTION_DECLARATION, name, parameters, slot));
 }
 
 void Parser::parseDoStatement() {
     auto body = next();
 
-    auto ps = Parser(Lexer(lexer.code, lexer.filename, body->children));
-    ps.parse();
+    auto slot = ast.reserve(2);
+    parseBlock(body, body->children, slot);
 
-    if (peek(1)->value == "while") {
+    if (peek(1)->atom == A_WHILE) {
         auto condition = next();
         if (condition->value[0] != '(') condition->throwError("SyntaxError: Expected '('");
-        // statements.push_back(make_unique<DoWhileStatement>(std::move(ps.statements), std::move(condition->children)));
+        // ast.scratch.push_back(ast.add(S_DO_WHILE, nullptr, parseExpression(ast, condition->children), slot));
+        forgetBlocks(TokenList(&body, 1));
         return;
     }
 
-    statements.push_back(make_unique<DoStatement>(std::move(ps.statements)));
+    ast.scratch.push_back(ast.add(S_DO, nullptr, slot));
 }
 
 void Parser::parseLoopStatement() {
     auto body = next();
 
-    auto ps = Parser(Lexer(lexer.code, lexer.filename, body->children));
-    ps.parse();
-
-    statements.push_back(make_unique<LoopStatement>(std::move(ps.statements)));
+    auto slot = ast.reserve(2);
+    parseBlock(body, body->children, slot);
+    ast.scratch.push_back(ast.add(S_LOOP, nullptr, slot));
 }
 
 void Parser::parseForLoopStatement() {
@@ -138,28 +155,30 @@ void Parser::parseForLoopStatement() {
     }
     auto body = next();
 
-    auto bodyPs = Parser(Lexer(lexer.code, lexer.filename, body->children));
-    bodyPs.parse();
+    // the body slot, then the init and the iterator statement
+    auto record = ast.reserve(4);
+    parseBlock(nullptr, body->children, record);
 
     if (is_classic) {
         auto spl = splitTokens(ins->children, ";");
         if (spl.size() != 3)
             ins->throwError("SyntaxError: Expected an init, condition and an iterator for the for loop.");
-        auto initPs = Parser(Lexer(lexer.code, lexer.filename, spl[0]));
-        auto iterPs = Parser(Lexer(lexer.code, lexer.filename, spl[2]));
-        initPs.parse();
-        iterPs.parse();
-        if (initPs.statements.size() != 1)
+        auto init = ast.reserve(2), iterator = ast.reserve(2);
+        parseBlock(nullptr, spl[0], init);
+        parseBlock(nullptr, spl[2], iterator);
+        if (ast.list(init).size() != 1)
             ins->throwError("SyntaxError: Expected a single init statement for the for loop.");
-        if (iterPs.statements.size() != 1)
+        if (ast.list(iterator).size() != 1)
             ins->throwError("SyntaxError: Expected a single iterator statement for the for loop.");
-        statements.push_back(make_unique<ForClassicStatement>(
-                std::move(initPs.statements[0]),
-                std::move(spl[1]),
-                std::move(iterPs.statements[0]),
-                std::move(bodyPs.statements)
-        ));
+        ast.extra[record + 2] = ast.list(init)[0];
+        ast.extra[record + 3] = ast.list(iterator)[0];
+        auto condition = parseExpression(ast, spl[1]);
+        if (body->type == T_GROUP && body->value[0] == '{') {
+            blocks[body] = record;
+        }
+        ast.scratch.push_back(ast.add(S_FOR_CLASSIC, nullptr, condition, record));
     } else {
+        forgetBlocks(TokenList(&body, 1));
     }
 }
 
@@ -167,51 +186,35 @@ void Parser::parseWhileLoopStatement() {
     auto condition = next();
     if (condition->value[0] != '(') condition->throwError("SyntaxError: Expected '('");
     auto body = next();
-    auto ps = Parser(Lexer(lexer.code, lexer.filename, body->children));
-    ps.parse();
 
-    statements.push_back(make_unique<WhileStatement>(std::move(condition->children), std::move(ps.statements)));
+    auto expression = parseExpression(ast, condition->children);
+    auto slot = ast.reserve(2);
+    parseBlock(body, body->children, slot);
+    ast.scratch.push_back(ast.add(S_WHILE, nullptr, expression, slot));
 }
 
 void Parser::parseIfFlowStatement() {
     auto condition = next();
     if (condition->value[0] != '(') condition->throwError("SyntaxError: Expected '('");
     auto body = next();
-    auto children = body->children;
-    if (body->value[0] != '{') {
-        --index;
-        Token *t;
-        accumulator = vector<Token *>();
-        while ((t = accumulate()) != lexer.eof && t->type != T_EOL && t->type != T_EOE) {}
-        accumulator.pop_back();
-        children = accumulator;
-    }
-    auto ps = Parser(Lexer(lexer.code, lexer.filename, children));
-    ps.parse();
+    auto children = body->value[0] == '{' ? body->children : restOfLine();
 
-    statements.push_back(make_unique<IfFlowStatement>(condition->children, std::move(ps.statements),
-                                                      vector<unique_ptr<Statement>>()));
+    auto expression = parseExpression(ast, condition->children);
+    // the body slot, then the else body slot
+    auto slots = ast.reserve(4);
+    parseBlock(body, children, slots);
+    ast.scratch.push_back(ast.add(S_IF_FLOW, nullptr, expression, slots));
 }
 
 void Parser::parseElseFlowStatement() {
-    if (statements.size() == 0 || statements.back()->type != S_IF_FLOW) {
+    if (ast.scratch.size() == output || ast.kinds[ast.scratch.back()] != S_IF_FLOW) {
         current()->throwError("SyntaxError: Expected an if statement before the 'else' keyword.");
     }
-    IfFlowStatement *ifStatement = (IfFlowStatement *) statements.back().get();
+    auto ifStatement = ast.scratch.back();
     auto body = next();
-    auto children = body->children;
-    if (body->value[0] != '{') {
-        --index;
-        Token *t;
-        accumulator = vector<Token *>();
-        while ((t = accumulate()) != lexer.eof && t->type != T_EOL && t->type != T_EOE) {}
-        accumulator.pop_back();
-        children = accumulator;
-    }
-    auto ps = Parser(Lexer(lexer.code, lexer.filename, children));
-    ps.parse();
+    auto children = body->value[0] == '{' ? body->children : restOfLine();
 
-    ifStatement->elseBody = std::move(ps.statements);
+    parseBlock(body, children, ast.rhs[ifStatement] + 2);
 }
 
 void Parser::parseClassDefinitionStatement() {}
@@ -219,14 +222,89 @@ void Parser::parseClassDefinitionStatement() {}
 void Parser::parseImportStatement() {}
 
 void Parser::parseReturnStatement() {
-    Token *t;
-    accumulator = vector<Token *>();
-    while ((t = accumulate()) != lexer.eof && t->type != T_EOL && t->type != T_EOE) {}
-    accumulator.pop_back();
-    statements.push_back(make_unique<ReturnStatement>(accumulator));
+    next();
+    ast.scratch.push_back(ast.add(S_RETURN, nullptr, parseExpression(ast, restOfLine())));
 }
 
 void Parser::parse() {
+    ast.clear();
+    blocks.clear();
+    root = ast.reserve(2);
+    deferred.clear();
+    deferring = true;
+    parseBlock(nullptr, lexer.tokens, root);
+    deferring = false;
+    parseDeferred();
+}
+
+// a thread for less source than this costs more than it saves
+#define DEFERRED_BYTES_PER_THREAD (64 * 1024)
+
+void Parser::parseDeferred() {
+    if (deferred.empty()) {
+        return;
+    }
+    size_t total = 0;
+    for (auto &body: deferred) {
+        total += body.first->end - body.first->start;
+    }
+    size_t count = threads != 0 ? threads : max(1u, thread::hardware_concurrency());
+    count = max<size_t>(1, min({count, deferred.size(), total / DEFERRED_BYTES_PER_THREAD}));
+
+    // runs of about the same amount of source, the tree comes out the same for any number of them
+    vector<size_t> bounds = {0};
+    size_t bytes = 0;
+    for (size_t i = 0; i < deferred.size() && bounds.size() < count; i++) {
+        bytes += deferred[i].first->end - deferred[i].first->start;
+        if (bytes * count >= total * bounds.size()) {
+            bounds.push_back(i + 1);
+        }
+    }
+    bounds.push_back(deferred.size());
+    count = bounds.size() - 1;
+
+    vector<Parser> workers(count, Parser(lexer));
+    vector<vector<uint32_t>> slots(count);
+    auto work = [&](size_t chunk) {
+        auto &worker = workers[chunk];
+        for (auto i = bounds[chunk]; i < bounds[chunk + 1]; i++) {
+            auto body = deferred[i].first;
+            auto slot = worker.ast.reserve(2);
+            slots[chunk].push_back(slot);
+            worker.parseBlock(body, body->children, slot);
+        }
+    };
+    vector<thread> pool;
+    for (size_t chunk = 1; chunk < count; chunk++) {
+        pool.emplace_back(work, chunk);
+    }
+    work(0);
+    for (auto &t: pool) {
+        t.join();
+    }
+
+    for (size_t chunk = 0; chunk < count; chunk++) {
+        auto &worker = workers[chunk];
+        auto words = ast.append(worker.ast, slots[chunk]);
+        for (auto &block: worker.blocks) {
+            blocks[block.first] = block.second + words;
+        }
+        for (auto i = bounds[chunk]; i < bounds[chunk + 1]; i++) {
+            auto slot = slots[chunk][i - bounds[chunk]] + words;
+            ast.extra[deferred[i].second] = ast.extra[slot];
+            ast.extra[deferred[i].second + 1] = ast.extra[slot + 1];
+            blocks[deferred[i].first] = deferred[i].second;
+        }
+    }
+    deferred.clear();
+}
+
+void Parser::parseStatements() {
+    // a statement with a syntax error is dropped up to the end of its line, groups are single tokens at this point so
+    // the enclosing block is never left, and parsing carries on with the next one
+    auto raising = raiseErrors;
+    raiseErrors = true;
+    auto failed = false;
     while (true) {
         auto token = next();
         if (token == lexer.eof) {
@@ -235,184 +313,85 @@ void Parser::parse() {
         if (token->type == T_EOL || token->type == T_EOE) {
             continue;
         }
-        if (token->value == "let" || token->value == "const") {
-            parseVariableDeclarationStatement();
-        } else if (token->value == "fn") {
-            parseFunctionDeclarationStatement();
-        } else if (token->value == "do") {
-            parseDoStatement();
-        } else if (token->value == "loop") {
-            parseLoopStatement();
-        } else if (token->value == "for") {
-            parseForLoopStatement();
-        } else if (token->value == "break") {
-            statements.push_back(make_unique<BreakStatement>());
-        } else if (token->value == "continue") {
-            statements.push_back(make_unique<ContinueStatement>());
-        } else if (token->value == "return") {
-            parseReturnStatement();
-        } else if (token->value == "if") {
-            parseIfFlowStatement();
-        } else if (token->value == "else") {
-            parseElseFlowStatement();
-        } else if (token->value == "while") {
-            parseWhileLoopStatement();
-        } else if (token->value == "class") {
-            parseClassDefinitionStatement();
-        } else if (token->value == "import") {
-            parseImportStatement();
-        } else if (token->value == "from") {
-            parseImportStatement();
-        } else {
-            auto indexBack = index;
-            Token *t;
-            while ((t = next()) != lexer.eof && t->value != ":=") {}
-            if (t->value == ":=") {
-                accumulator = vector<Token *>();
-                while ((t = accumulate()) != lexer.eof && t->type != T_EOL && t->type != T_EOE) {}
-                accumulator.pop_back();
-                auto value = accumulator;
-
-                statements.push_back(make_unique<VariableDeclarationStatement>(token, value, false));
-                continue;
-            }
-            index = --indexBack;
-
-            accumulator = vector<Token *>();
-            while ((token = accumulate()) != lexer.eof && token->type != T_EOL && token->type != T_EOE) {}
-            accumulator.pop_back();
-            statements.push_back(make_unique<ExpressionStatement>(accumulator));
+        if (failed && token->atom == A_ELSE) {
+            // the if it belongs to is gone, its errors would only repeat that
+            skipStatement();
+            continue;
+        }
+        auto mark = ast.scratch.size();
+        try {
+            parseStatement(token);
+            failed = false;
+        } catch (ErrorRaised &) {
+            ast.scratch.resize(mark);
+            skipStatement();
+            failed = true;
         }
     }
+    raiseErrors = raising;
 }
 
-string Parser::toString() {
-    string result = "[";
-    size_t i = 0;
-    for (const auto &s: statements) {
-        result += s->toString() + (i < statements.size() - 1 ? "\n" : "");
-        ++i;
-    }
-    return result + "]";
-}
-
-__attribute__((unused)) void Parser::dump() {
-    cout << toString() << endl;
-}
-
-string Statement::toString() {
-    if (type == S_VARIABLE_DECLARATION) {
-        return ((VariableDeclarationStatement *) this)->toString();
-    } else if (type == S_FUNCTION_DECLARATION) {
-        return ((FunctionDeclarationStatement *) this)->toString();
-    } else if (type == S_DO) {
-        return ((DoStatement *) this)->toString();
-    } else if (type == S_LOOP) {
-        return ((LoopStatement *) this)->toString();
-    } else if (type == S_WHILE) {
-        return ((WhileStatement *) this)->toString();
-    } else if (type == S_DO_WHILE) {
-        return ((DoWhileStatement *) this)->toString();
-    } else if (type == S_FOR_ITERATOR) {
-        return ((ForIteratorStatement *) this)->toString();
-    } else if (type == S_FOR_CLASSIC) {
-        return ((ForClassicStatement *) this)->toString();
-    } else if (type == S_CLASS_DEFINITION) {
-        return ((ClassDefinitionStatement *) this)->toString();
-    } else if (type == S_IF_FLOW) {
-        return ((IfFlowStatement *) this)->toString();
-    } else if (type == S_IMPORT) {
-        return ((ImportStatement *) this)->toString();
-    } else if (type == S_RETURN) {
-        return ((ReturnStatement *) this)->toString();
-    } else if (type == S_BREAK) {
-        return ((BreakStatement *) this)->toString();
-    } else if (type == S_CONTINUE) {
-        return ((ContinueStatement *) this)->toString();
-    } else if (type == S_EXPRESSION) {
-        return ((ExpressionStatement *) this)->toString();
+void Parser::skipStatement() {
+    auto t = current();
+    while (t != lexer.eof && t->type != T_EOL && t->type != T_EOE) {
+        t = next();
     }
-    return "Unknown Statement";
 }
 
-string statementsToString(string pre, vector<unique_ptr<Statement>> &statements) {
-    string result = "";
-    string nl = "\n" + pre;
-    for (const auto &s: statements) {
-        result += pre + regex_replace(s->toString(), regex("\n"), nl) + "\n";
+void Parser::parseStatement(Token *token) {
+    if (token->atom == A_LET || token->atom == A_CONST) {
+        parseVariableDeclarationStatement();
+    } else if (token->atom == A_FN) {
+        parseFunctionDeclarationStatement();
+    } else if (token->atom == A_DO) {
+        parseDoStatement();
+    } else if (token->atom == A_LOOP) {
+        parseLoopStatement();
+    } else if (token->atom == A_FOR) {
+        parseForLoopStatement();
+    } else if (token->atom == A_BREAK) {
+        ast.scratch.push_back(ast.add(S_BREAK, token));
+    } else if (token->atom == A_CONTINUE) {
+        ast.scratch.push_back(ast.add(S_CONTINUE, token));
+    } else if (token->atom == A_RETURN) {
+        parseReturnStatement();
+    } else if (token->atom == A_IF) {
+        parseIfFlowStatement();
+    } else if (token->atom == A_ELSE) {
+        parseElseFlowStatement();
+    } else if (token->atom == A_WHILE) {
+        parseWhileLoopStatement();
+    } else if (token->atom == A_CLASS) {
+        parseClassDefinitionStatement();
+    } else if (token->atom == A_IMPORT) {
+        parseImportStatement();
+    } else if (token->atom == A_FROM) {
+        parseImportStatement();
+    } else {
+        // <identifier> := <expression> declares, anything else on the line is an expression
+        auto start = index;
+        Token *t;
+        while ((t = next()) != lexer.eof && t->type != T_EOL && t->type != T_EOE && t->value != ":=") {}
+        if (t->value == ":=") {
+            next();
+            auto value = parseExpression(ast, restOfLine());
+            ast.scratch.push_back(ast.add(S_VARIABLE_DECLARATION, token, value));
+            return;
+        }
+        index = start;
+        ast.scratch.push_back(ast.add(S_EXPRESSION, nullptr, parseExpression(ast, restOfLine())));
     }
-    return result;
-}
-
-string VariableDeclarationStatement::toString() {
-    return "{'type': 'variable declaration', 'identifier': " + name->toString() + ", 'value': [" +
-           tokensToString("", value) +
-           "], 'constant': " + (constant ? "true" : "false") + "}";
-}
-
-string FunctionDeclarationStatement::toString() {
-    return "{'type': 'function declaration', 'name': '" + name->value + "', 'arguments': " +
-           tokensListToString("", arguments) + ", 'body': [\n" +
-           statementsToString("    ", body) + "]}";
-}
-
-string DoStatement::toString() {
-    return "{'type': 'do', 'body': [\n" + statementsToString("    ", body) + "]}";
-}
-
-string LoopStatement::toString() {
-    return "{'type': 'loop', 'body': [\n" + statementsToString("    ", body) + "]}";
-}
-
-string WhileStatement::toString() {
-    return "{'type': 'while', 'condition': [\n" + tokensToString("    ", condition) + "], 'body': [\n" +
-           statementsToString("    ", body) + "]}";
-}
-
-string DoWhileStatement::toString() {
-    return "{'type': 'do while', 'condition': [\n" + tokensToString("    ", condition) + "], 'body': [\n" +
-           statementsToString("    ", body) + "]}";
-}
-
-string ForIteratorStatement::toString() {
-    return "{'type': 'for iterator', 'index': " + index->toString() + ", 'value': " + value->toString() +
-           ", 'iterator': [\n" + tokensToString("    ", iterator) + "]}";
-}
-
-string ForClassicStatement::toString() {
-    return "{'type': 'for classic', 'init': " + init->toString() + ", 'condition': [\n" +
-           tokensToString("    ", condition) + "], 'iterator': " + iterator->toString() + ", 'body': [\n" +
-           statementsToString("    ", body) + "]}";
-}
-
-string BreakStatement::toString() {
-    return "{'type': 'break'}";
 }
 
-string ContinueStatement::toString() {
-    return "{'type': 'continue'}";
-}
-
-string ReturnStatement::toString() {
-    return "{'type': 'return', 'expression': [\n" + tokensToString("", value) + "]}";
-}
-
-string ClassDefinitionStatement::toString() {
-    return "{'type': 'class definition', 'attributes': [\n" + statementsToString("", attributes) + "], 'methods': [\n" +
-           statementsToString("    ", methods) + "]}";
-}
-
-string IfFlowStatement::toString() {
-    return "{'type': 'if flow', 'condition': [\n" + tokensToString("    ", condition) + "], "
-           + "'body': [\n" + statementsToString("    ", body) + "], "
-           + "'elseBody': [\n" + statementsToString("    ", elseBody) + "]}";
-}
-
-string ImportStatement::toString() {
-    return "{'type': 'import', 'name': [\n" + name->toString() + "], 'imports': [\n" + tokensToString("", imports) +
-           "]}";
+string Parser::toString() {
+    ostringstream out;
+    JsonWriter json(out);
+    writeNodes(json, ast, statements());
+    return out.str();
 }
 
-string ExpressionStatement::toString() {
-    return "{'type': 'expression', 'expression': [\n" + tokensToString("", expression) + "]}";
+__attribute__((unused)) void Parser::dump() {
+    JsonWriter json(cout);
+    writeNodes(json, ast, statements());
+    cout << endl;
 }
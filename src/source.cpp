@@ -0,0 +1,156 @@
+#include "source.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Source::Source(string filename, string code) : filename(std::move(filename)), storage(std::move(code)) {
+    this->code = storage;
+}
+
+Source::~Source() {
+#ifndef WIN32
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+    }
+#endif
+}
+
+const Source *Source::forward(size_t &offset) const {
+    auto source = this;
+    while (source->edited != nullptr) {
+        if (offset >= source->editEnd) {
+            offset += source->editDelta;
+        }
+        source = source->edited;
+    }
+    return source;
+}
+
+const vector<size_t> &Source::lineIndex() const {
+    call_once(lineIndexed, [this]() {
+        lineStarts.push_back(0);
+        auto begin = code.data();
+        auto end = begin + code.size();
+        for (auto p = begin; (p = (const char *) memchr(p, '\n', end - p)) != nullptr; ++p) {
+            lineStarts.push_back(p + 1 - begin);
+        }
+    });
+    return lineStarts;
+}
+
+void Source::location(size_t offset, size_t &line, size_t &column) const {
+    auto &starts = lineIndex();
+    line = upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+    column = offset - starts[line - 1] + 1;
+}
+
+string_view Source::line(size_t number) const {
+    auto &starts = lineIndex();
+    auto start = starts[number - 1];
+    auto end = number < starts.size() ? starts[number] - 1 : code.size();
+    return code.substr(start, end - start);
+}
+
+#ifndef WIN32
+
+static bool readChunks(int fd, string &storage, size_t chunkSize = SOURCE_CHUNK_SIZE) {
+    // pipes don't know their size, grow the buffer one chunk at a time
+    while (true) {
+        auto size = storage.size();
+        storage.resize(size + chunkSize);
+        auto n = read(fd, &storage[size], chunkSize);
+        if (n < 0) {
+            return false;
+        }
+        storage.resize(size + n);
+        if (n == 0) {
+            return true;
+        }
+    }
+}
+
+shared_ptr<Source> Source::load(const string &filename, bool mapped) {
+    auto source = shared_ptr<Source>(new Source(filename));
+    if (filename == "-") {
+        if (!readChunks(STDIN_FILENO, source->storage)) {
+            return nullptr;
+        }
+        source->code = source->storage;
+        return source;
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    if (!S_ISREG(st.st_mode) || !mapped) {
+        auto ok = readChunks(fd, source->storage, S_ISREG(st.st_mode) ? st.st_size + 1 : SOURCE_CHUNK_SIZE);
+        close(fd);
+        if (!ok) {
+            return nullptr;
+        }
+        source->code = source->storage;
+        return source;
+    }
+    if (st.st_size > 0) {
+        auto mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+        // the lexer walks the file front to back exactly once
+        madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+        source->mapping = mapping;
+        source->mappingSize = st.st_size;
+        source->code = string_view((const char *) mapping, st.st_size);
+    }
+    close(fd);
+    return source;
+}
+
+void Source::prefetch(size_t offset, size_t length) const {
+    if (mapping == nullptr || offset >= mappingSize) {
+        return;
+    }
+    auto page = (size_t) sysconf(_SC_PAGESIZE);
+    auto start = offset / page * page;
+    auto end = min(offset + length, mappingSize);
+    madvise((char *) mapping + start, end - start, MADV_WILLNEED);
+}
+
+#else
+
+shared_ptr<Source> Source::load(const string &filename, bool mapped) {
+    auto source = shared_ptr<Source>(new Source(filename));
+    stringstream buffer;
+    if (filename == "-") {
+        buffer << cin.rdbuf();
+    } else {
+        ifstream file(filename, ios::binary);
+        if (!file.is_open()) {
+            return nullptr;
+        }
+        buffer << file.rdbuf();
+    }
+    source->storage = buffer.str();
+    source->code = source->storage;
+    return source;
+}
+
+void Source::prefetch(size_t offset, size_t length) const {}
+
+#endif